@@ -0,0 +1,245 @@
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "Benchmark.hpp"
+#include "Interpreter.hpp"
+#include "SourceFile.hpp"
+
+// Runs every script in a directory through the -bench harness and compares each one's
+// median total time against a baseline file of "name median_ns" lines.
+
+static std::vector<std::string> FindScripts(const std::string& directory)
+{
+    // Only the top level, so subdirectories can hold the modules scripts import
+    std::vector<std::string> paths;
+    std::error_code error;
+    for (std::filesystem::directory_iterator it(directory, error), end; !error && it != end; it.increment(error))
+    {
+        if (it->is_regular_file(error) && it->path().extension() == ".txt")
+        {
+            paths.push_back(it->path().string());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
+
+static std::map<std::string, long long> ReadBaseline(const std::string& path)
+{
+    std::map<std::string, long long> baseline;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line))
+    {
+        std::istringstream stream(line);
+        std::string name;
+        long long median = 0;
+        if (line.empty() || line[0] == '#' || !(stream >> name >> median))
+        {
+            continue;
+        }
+        baseline[name] = median;
+    }
+    return baseline;
+}
+
+// Times only compare on the machine that recorded them, so the baseline says which one that was
+static std::string DescribeMachine()
+{
+    std::string cpu = "unknown CPU";
+    std::ifstream cpuInfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuInfo, line))
+    {
+        size_t colon = line.find(':');
+        if (line.compare(0, 10, "model name") == 0 && colon != std::string::npos && colon + 2 < line.size())
+        {
+            cpu = line.substr(colon + 2);
+            break;
+        }
+    }
+
+    std::string compiler = "unknown compiler";
+#if defined(__clang__)
+    compiler = "Clang " __clang_version__;
+#elif defined(__GNUC__)
+    compiler = "GCC " __VERSION__;
+#elif defined(_MSC_VER)
+    compiler = "MSVC " + std::to_string(_MSC_VER);
+#endif
+
+    unsigned int threads = std::thread::hardware_concurrency();
+    return cpu + ", " + std::to_string(threads) + (threads == 1 ? " hardware thread, " : " hardware threads, ") + compiler;
+}
+
+static bool WriteBaseline(const std::string& path, const std::map<std::string, long long>& medians)
+{
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    file << "# Median total time in nanoseconds of each bench/scripts workload, from a Release build. Rewrite with the benchsuite_update target.\n";
+    file << "# Recorded on " << DescribeMachine() << '\n';
+    for (const auto& median : medians)
+    {
+        file << median.first << ' ' << median.second << '\n';
+    }
+    file.close();
+    return !file.fail();
+}
+
+static void PrintUsage()
+{
+    std::cout << "Usage: BenchSuite <directory> [-baseline file] [-update] [-runs N] [-warmup N] [-threshold percent] [-cachedir directory]\n";
+}
+
+int main(int argc, char** argv)
+{
+    std::string directory = "";
+    std::string baselinePath = "";
+    std::string cacheDirectory = "";
+    bool update = false;
+    unsigned int runs = 5;
+    unsigned int warmupRuns = 1;
+    unsigned int threshold = 25;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "-baseline" && i + 1 < argc)
+        {
+            baselinePath = argv[++i];
+        }
+        else if (arg == "-cachedir" && i + 1 < argc)
+        {
+            cacheDirectory = argv[++i];
+        }
+        else if (arg == "-update")
+        {
+            update = true;
+        }
+        else if ((arg == "-runs" || arg == "-warmup" || arg == "-threshold") && i + 1 < argc)
+        {
+            try
+            {
+                unsigned int number = std::stoul(argv[++i]);
+                if (arg == "-runs")
+                    runs = number;
+                else if (arg == "-warmup")
+                    warmupRuns = number;
+                else
+                    threshold = number;
+            }
+            catch (const std::exception& e)
+            {
+                std::cout << "Invalid number " << argv[i] << " for " << arg << '\n';
+                PrintUsage();
+                return 1;
+            }
+        }
+        else if (directory.empty() && arg[0] != '-')
+        {
+            directory = arg;
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    std::vector<std::string> scripts = FindScripts(directory);
+    if (scripts.empty())
+    {
+        std::cout << "No scripts in " << directory << '\n';
+        return 1;
+    }
+
+    std::map<std::string, long long> baseline;
+    if (!baselinePath.empty() && !update)
+    {
+        baseline = ReadBaseline(baselinePath);
+    }
+
+    Interpreter interpreter;
+    if (!cacheDirectory.empty())
+    {
+        interpreter.GetModuleCache().SetDirectory(cacheDirectory);
+    }
+    Benchmark benchmark;
+    benchmark.SetRuns(runs);
+    benchmark.SetWarmupRuns(warmupRuns);
+
+    std::map<std::string, long long> medians;
+    unsigned int failed = 0;
+    unsigned int regressed = 0;
+    std::cout << std::fixed << std::setprecision(3);
+    for (const std::string& path : scripts)
+    {
+        const SourceFile* source = SourceFile::Load(path);
+        std::string name = std::filesystem::path(path).stem().string();
+        if (source == nullptr)
+        {
+            std::cout << std::left << std::setw(12) << name << std::right << " failed to open\n";
+            failed++;
+            continue;
+        }
+
+        // What the scripts print isn't part of the report, unless it explains a failure
+        std::ostringstream output;
+        std::streambuf* consoleBuffer = std::cout.rdbuf(output.rdbuf());
+        interpreter.SetCurrentDirectory(path);
+        bool isValid = benchmark.Run(source, interpreter);
+        std::cout.rdbuf(consoleBuffer);
+
+        if (!isValid)
+        {
+            std::cout << std::left << std::setw(12) << name << std::right << " failed\n" << output.str();
+            failed++;
+            continue;
+        }
+
+        const Benchmark::Phase& total = benchmark.GetPhases().back();
+        long long median = (long long)total.Median();
+        medians[name] = median;
+        std::cout << std::left << std::setw(12) << name << std::right
+                  << " median " << std::setw(10) << median / 1e6 << "ms, p95 " << std::setw(10) << total.Percentile(95) / 1e6
+                  << "ms, stddev " << std::setw(8) << total.StandardDeviation() / 1e6 << "ms";
+
+        auto expected = baseline.find(name);
+        if (expected != baseline.end() && expected->second > 0)
+        {
+            double ratio = (double)median / expected->second;
+            bool isRegression = ratio > 1.0 + threshold / 100.0;
+            regressed += isRegression;
+            std::cout << ", " << std::setprecision(2) << ratio << "x baseline" << std::setprecision(3) << (isRegression ? " REGRESSED" : "");
+        }
+        else if (!baseline.empty())
+        {
+            std::cout << ", not in baseline";
+        }
+        std::cout << '\n';
+    }
+
+    if (update && !baselinePath.empty())
+    {
+        if (!WriteBaseline(baselinePath, medians))
+        {
+            std::cout << "Failed to write " << baselinePath << '\n';
+            return 1;
+        }
+        std::cout << "Wrote " << baselinePath << '\n';
+    }
+
+    std::cout << scripts.size() << " scripts, " << failed << " failed, " << regressed << " slower than baseline by more than " << threshold << "%\n";
+    return failed + regressed == 0 ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,151 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Lexer.hpp"
+#include "Parser.hpp"
+#include "SourceFile.hpp"
+#include "Token.hpp"
+
+// Expression-heavy code with a bit of everything else, repeated to the requested size
+static const char* s_sampleChunk =
+    "// Generated benchmark input\n"
+    "counter_%1 = 0;\n"
+    "step%1 = func\n"
+    "{\n"
+    "    /* mix of arithmetic, comparison and logic */\n"
+    "    total = args[0] + args[1] * 2.5 - (args[2] / 4) ^ 2 + -args[0] * 3 ^ 2 ^ 1;\n"
+    "    limit = (total - 1) * (total + 1) / (2 * counter_%1 + 1) - total / 3;\n"
+    "    if (total >= 100 && total != 250 || !(done) && limit < total * 2)\n"
+    "    {\n"
+    "        print(\"total is \" + total);\n"
+    "    }\n"
+    "    else\n"
+    "    {\n"
+    "        counter_%1 = counter_%1 + 1;\n"
+    "    };\n"
+    "    return total;\n"
+    "};\n"
+    "for (i = 0; i < 10; i = i + 1) { step%1(i, true, null); };\n";
+
+static std::string GenerateSource(size_t targetSize)
+{
+    std::string source;
+    source.reserve(targetSize + 1024);
+    std::string chunk = s_sampleChunk;
+    for (unsigned int index = 0; source.size() < targetSize; index++)
+    {
+        std::string suffix = std::to_string(index);
+        std::string text = chunk;
+        for (size_t pos = text.find("%1"); pos != std::string::npos; pos = text.find("%1", pos))
+        {
+            text.replace(pos, 2, suffix);
+        }
+        source += text;
+    }
+    return source;
+}
+
+int main(int argc, char** argv)
+{
+    std::string path = "";
+    size_t sizeMB = 4;
+    unsigned int runs = 5;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "-size" && i + 1 < argc)
+        {
+            sizeMB = std::stoul(argv[++i]);
+        }
+        else if (arg == "-runs" && i + 1 < argc)
+        {
+            runs = std::stoul(argv[++i]);
+        }
+        else if (path.empty() && arg[0] != '-')
+        {
+            path = arg;
+        }
+        else
+        {
+            std::cout << "Usage: FrontEndBench [file] [-size MB] [-runs N]\n";
+            return 1;
+        }
+    }
+
+    const SourceFile* source = nullptr;
+    if (path.empty())
+    {
+        source = SourceFile::Keep(SourceFile::FromString("generated", GenerateSource(sizeMB * 1024 * 1024)));
+    }
+    else
+    {
+        source = SourceFile::Load(path);
+        if (source == nullptr)
+        {
+            std::cout << "Failed to open file " << path << '\n';
+            return 1;
+        }
+    }
+
+    std::string_view text = source->GetText();
+    std::cout << "Source: " << source->GetName() << " (" << text.size() / 1024 << " KB)\n";
+
+    size_t tokenCount = 0;
+    double bestLexSeconds = 0.0;
+    double totalLexSeconds = 0.0;
+    for (unsigned int run = 0; run < runs; run++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        Lexer lexer(source);
+        std::vector<Token> tokens = lexer.generateTokens();
+        auto end = std::chrono::steady_clock::now();
+
+        if (tokens.empty())
+        {
+            std::cout << "Lexing failed.\n";
+            return 1;
+        }
+
+        double seconds = std::chrono::duration<double>(end - start).count();
+        tokenCount = tokens.size();
+        totalLexSeconds += seconds;
+        if (run == 0 || seconds < bestLexSeconds)
+        {
+            bestLexSeconds = seconds;
+        }
+    }
+
+    std::cout << "Lexer: " << tokenCount << " tokens, best " << bestLexSeconds * 1000.0 << "ms, mean " << totalLexSeconds / runs * 1000.0 << "ms\n";
+    std::cout << "Lexer: " << (size_t)(tokenCount / bestLexSeconds) << " tokens/sec, " << text.size() / bestLexSeconds / (1024 * 1024) << " MB/sec\n";
+
+    // Parsing pulls its own tokens, so this is the whole front end
+    double bestParseSeconds = 0.0;
+    double totalParseSeconds = 0.0;
+    for (unsigned int run = 0; run < runs; run++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        Lexer lexer(source);
+        Parser parser(lexer);
+        TokenNode* node = parser.Parse();
+        auto end = std::chrono::steady_clock::now();
+
+        if (node == NULL)
+        {
+            std::cout << "Parsing failed.\n";
+            return 1;
+        }
+
+        double seconds = std::chrono::duration<double>(end - start).count();
+        totalParseSeconds += seconds;
+        if (run == 0 || seconds < bestParseSeconds)
+        {
+            bestParseSeconds = seconds;
+        }
+    }
+
+    std::cout << "Parser: best " << bestParseSeconds * 1000.0 << "ms, mean " << totalParseSeconds / runs * 1000.0 << "ms\n";
+    std::cout << "Parser: " << (size_t)(tokenCount / bestParseSeconds) << " tokens/sec, " << text.size() / bestParseSeconds / (1024 * 1024) << " MB/sec\n";
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,386 @@
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Lexer.hpp"
+#include "Parser.hpp"
+#include "SourceFile.hpp"
+#include "SymbolTable.hpp"
+#include "Token.hpp"
+#include "TokenNode.hpp"
+#include "Value.hpp"
+
+// Results are written here so the compiler can't drop the work that produced them
+static volatile size_t s_sink = 0;
+
+// A little of every statement, repeated to the requested size
+static const char* s_sampleChunk =
+    "limit_%1 = 10;\n"
+    "scale%1 = func\n"
+    "{\n"
+    "    total = args[0] * 2.5 - (args[1] / 4) ^ 2;\n"
+    "    if (total >= limit_%1 && total != 250 || !(args[2]))\n"
+    "    {\n"
+    "        print(\"total is \" + total);\n"
+    "    };\n"
+    "    return total;\n"
+    "};\n"
+    "values_%1 = [1, 2, \"three\", [4, 5]];\n"
+    "foreach (value in values_%1) { scale%1(value, limit_%1, null); };\n";
+
+static std::string GenerateSource(size_t targetSize)
+{
+    std::string source;
+    std::string chunk = s_sampleChunk;
+    for (unsigned int index = 0; source.size() < targetSize; index++)
+    {
+        std::string text = chunk;
+        for (size_t pos = text.find("%1"); pos != std::string::npos; pos = text.find("%1", pos))
+        {
+            text.replace(pos, 2, std::to_string(index));
+        }
+        source += text;
+    }
+    return source;
+}
+
+class MicroBench
+{
+public:
+    MicroBench(const std::string& filter, double secondsPerCase)
+        : m_filter(filter), m_secondsPerCase(secondsPerCase)
+    {
+    }
+
+    // body(count) runs the operation count times. bytes, if given, is how much input one operation reads.
+    template<typename Body>
+    void Run(const std::string& name, Body body, size_t bytes = 0)
+    {
+        if (name.find(m_filter) == std::string::npos)
+        {
+            return;
+        }
+
+        // Grow the batch until it's long enough for the clock, then keep the best of several batches
+        const unsigned int batchCount = 5;
+        size_t count = 1;
+        double seconds = time(body, count);
+        while (seconds < m_secondsPerCase / (batchCount * 4) && count < ((size_t)1 << 40))
+        {
+            count *= 2;
+            seconds = time(body, count);
+        }
+        double best = seconds;
+        for (unsigned int batch = 1; batch < batchCount; batch++)
+        {
+            best = std::min(best, time(body, count));
+        }
+
+        double nanoseconds = best / count * 1e9;
+        std::cout << std::left << std::setw(36) << name << std::right << std::setw(14) << std::fixed << std::setprecision(1) << nanoseconds << " ns/op";
+        if (bytes != 0)
+        {
+            std::cout << std::setw(10) << std::setprecision(1) << bytes / (nanoseconds / 1e9) / (1024 * 1024) << " MB/sec";
+        }
+        std::cout << '\n';
+    }
+
+private:
+    std::string m_filter;
+    double m_secondsPerCase;
+
+    template<typename Body>
+    static double time(Body& body, size_t count)
+    {
+        auto start = std::chrono::steady_clock::now();
+        body(count);
+        auto end = std::chrono::steady_clock::now();
+        return std::chrono::duration<double>(end - start).count();
+    }
+};
+
+// Nests depth - 1 scopes beneath root and returns the innermost, so a lookup from it walks depth tables
+static SymbolTable* NestScopes(SymbolTable& root, unsigned int depth)
+{
+    SymbolTable* scope = &root;
+    for (unsigned int i = 1; i < depth; i++)
+    {
+        std::string name = "scope" + std::to_string(i);
+        scope->AddScope(name);
+        scope = scope->GetScope(name);
+    }
+    return scope;
+}
+
+static void BenchFrontEnd(MicroBench& bench, const SourceFile* source)
+{
+    size_t bytes = source->GetText().size();
+
+    bench.Run("lexer/generateTokens", [source](size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            Lexer lexer(source);
+            s_sink = s_sink + lexer.generateTokens().size();
+        }
+    }, bytes);
+
+    // Trees are leaked like the interpreter leaks them, so this includes allocating the nodes but not freeing them
+    bench.Run("parser/Parse", [source](size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            Lexer lexer(source);
+            Parser parser(lexer);
+            s_sink = s_sink + (parser.Parse() != NULL);
+        }
+    }, bytes);
+}
+
+static void BenchValues(MicroBench& bench)
+{
+    const std::string shortText = "short";
+    const std::string longText(64, 'x');
+    const std::vector<Value> array(8, Value(1.0f));
+
+    const Value number(2.5f);
+    const Value shortString(shortText);
+    const Value longString(longText);
+    const Value arrayValue(array);
+
+    bench.Run("value/construct/number", [](size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            Value value((float)i);
+            s_sink = s_sink + value.isNumber();
+        }
+    });
+    bench.Run("value/construct/string", [&shortText](size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            Value value(shortText);
+            s_sink = s_sink + value.isString();
+        }
+    });
+    bench.Run("value/construct/string-long", [&longText](size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            Value value(longText);
+            s_sink = s_sink + value.isString();
+        }
+    });
+    bench.Run("value/construct/array", [&array](size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            Value value(array);
+            s_sink = s_sink + value.size();
+        }
+    });
+
+    const std::pair<const char*, const Value*> copies[] =
+    {
+        { "value/copy/number", &number },
+        { "value/copy/string", &shortString },
+        { "value/copy/string-long", &longString },
+        { "value/copy/array", &arrayValue }
+    };
+    for (const auto& copy : copies)
+    {
+        const Value* source = copy.second;
+        bench.Run(copy.first, [source](size_t count)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                Value value(*source);
+                s_sink = s_sink + value.isNull();
+            }
+        });
+    }
+
+    bench.Run("value/add/number", [&number](size_t count)
+    {
+        Value total(0.0f);
+        for (size_t i = 0; i < count; i++)
+        {
+            total = total + number;
+        }
+        s_sink = s_sink + (size_t)total.getNumber();
+    });
+    bench.Run("value/multiply/number", [&number](size_t count)
+    {
+        Value total(1.0f);
+        for (size_t i = 0; i < count; i++)
+        {
+            total = total * number;
+            total = total / number;
+        }
+        s_sink = s_sink + (size_t)total.getNumber();
+    });
+    bench.Run("value/add/string", [&shortString](size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            Value joined = shortString + shortString;
+            s_sink = s_sink + joined.isString();
+        }
+    });
+    bench.Run("value/add/string-number", [&shortString, &number](size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            Value joined = shortString + number;
+            s_sink = s_sink + joined.isString();
+        }
+    });
+    bench.Run("value/add/array-element", [&arrayValue, &number](size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            Value appended = arrayValue + number;
+            s_sink = s_sink + appended.size();
+        }
+    });
+    bench.Run("value/compare/string", [&shortString, &longString](size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            s_sink = s_sink + (shortString == longString);
+        }
+    });
+}
+
+static void BenchSymbolTable(MicroBench& bench)
+{
+    for (unsigned int depth : { 1u, 4u, 16u, 64u })
+    {
+        SymbolTable root("global", NULL);
+        root.RegisterVar("target", Value(1.0f));
+        SymbolTable* scope = NestScopes(root, depth);
+        std::string suffix = "/depth-" + std::to_string(depth);
+
+        bench.Run("symbols/GetVar" + suffix, [scope](size_t count)
+        {
+            const std::string name = "target";
+            for (size_t i = 0; i < count; i++)
+            {
+                s_sink = s_sink + scope->GetVar(name, true).isNumber();
+            }
+        });
+        bench.Run("symbols/RegisterVar" + suffix, [scope](size_t count)
+        {
+            const std::string name = "target";
+            const Value value(2.0f);
+            for (size_t i = 0; i < count; i++)
+            {
+                scope->RegisterVar(name, value);
+            }
+        });
+        // Built-ins live in the global table, so a call from a nested scope walks up to it
+        bench.Run("symbols/CallBuiltInFunction" + suffix, [scope](size_t count)
+        {
+            const std::string name = "abs";
+            const std::vector<Value> args = { Value(-2.0f) };
+            for (size_t i = 0; i < count; i++)
+            {
+                s_sink = s_sink + scope->CallBuiltInFunction(name, args).isNumber();
+            }
+        });
+
+        root.CleanUp();
+    }
+
+    SymbolTable root("global", NULL);
+    bench.Run("symbols/AddScope+RemoveScope", [&root](size_t count)
+    {
+        const std::string name = "block";
+        for (size_t i = 0; i < count; i++)
+        {
+            root.AddScope(name);
+            root.RemoveScope(name);
+        }
+    });
+    bench.Run("symbols/RegisterLocalVar+DestroyVar", [&root](size_t count)
+    {
+        const std::string name = "local";
+        const Value value(1.0f);
+        for (size_t i = 0; i < count; i++)
+        {
+            root.RegisterLocalVar(name, value);
+            root.DestroyVar(name);
+        }
+    });
+
+    const std::pair<const char*, std::vector<Value>> calls[] =
+    {
+        { "sqrt", { Value(2.0f) } },
+        { "floor", { Value(2.5f) } },
+        { "strlen", { Value(std::string("some text")) } },
+        { "sizeof", { Value(std::vector<Value>(8, Value(1.0f))) } },
+        { "tostring", { Value(12.5f) } }
+    };
+    for (const auto& call : calls)
+    {
+        const std::string name = call.first;
+        const std::vector<Value>& args = call.second;
+        bench.Run("builtin/" + name, [&root, &name, &args](size_t count)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                s_sink = s_sink + root.CallBuiltInFunction(name, args).isNull();
+            }
+        });
+    }
+
+    root.CleanUp();
+}
+
+int main(int argc, char** argv)
+{
+    std::string filter = "";
+    size_t sizeKB = 64;
+    unsigned int milliseconds = 200;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        try
+        {
+            if (arg == "-filter" && i + 1 < argc)
+            {
+                filter = argv[++i];
+            }
+            else if (arg == "-size" && i + 1 < argc)
+            {
+                sizeKB = std::stoul(argv[++i]);
+            }
+            else if (arg == "-time" && i + 1 < argc)
+            {
+                milliseconds = std::stoul(argv[++i]);
+            }
+            else
+            {
+                std::cout << "Usage: MicroBench [-filter text] [-size KB] [-time ms]\n";
+                return 1;
+            }
+        }
+        catch (const std::exception&)
+        {
+            std::cout << "Invalid value for " << arg << '\n';
+            return 1;
+        }
+    }
+
+    const SourceFile* source = SourceFile::Keep(SourceFile::FromString("generated", GenerateSource(sizeKB * 1024)));
+
+    MicroBench bench(filter, milliseconds / 1000.0);
+    BenchFrontEnd(bench, source);
+    BenchValues(bench);
+    BenchSymbolTable(bench);
+    return 0;
+}
\ No newline at end of file
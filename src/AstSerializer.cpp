@@ -0,0 +1,515 @@
+#include "AstSerializer.hpp"
+
+#include <cstring>
+
+#include "Parser.hpp"
+
+// Written in place of a missing child node
+static const unsigned char NullNode = 0xFF;
+
+enum class ValueTag : unsigned char
+{
+    Number,
+    String,
+    Array,
+    ObjectPointer,
+    Null
+};
+
+AstWriter::AstWriter(SourceLocation baseLocation)
+    : m_baseLocation(baseLocation)
+{
+}
+
+AstWriter::~AstWriter()
+{
+}
+
+void AstWriter::WriteNode(TokenNode* node)
+{
+    if (node != NULL && node->GetType() == NodeType::LazyBlock)
+    {
+        // Entries are loaded without their source, so bodies are written out in full
+        LazyBlockNode* lazyNode = dynamic_cast<LazyBlockNode*>(node);
+        if (!lazyNode->IsCompiled())
+        {
+            Parser::Compile(lazyNode);
+        }
+        node = lazyNode->GetBlock();
+    }
+
+    if (node == NULL)
+    {
+        WriteByte(NullNode);
+        return;
+    }
+
+    WriteByte((unsigned char)node->GetType());
+    writeToken(node->GetToken());
+
+    switch (node->GetType())
+    {
+        case NodeType::Sequence:
+            writeNodes(dynamic_cast<SequenceNode*>(node)->GetNodes());
+            break;
+        case NodeType::BinaryOperation:
+        {
+            BinaryOperationNode* binOpNode = dynamic_cast<BinaryOperationNode*>(node);
+            WriteNode(binOpNode->GetLeft());
+            WriteNode(binOpNode->GetRight());
+            break;
+        }
+        case NodeType::UnaryOperation:
+            WriteNode(dynamic_cast<UnaryOperationNode*>(node)->GetRight());
+            break;
+        case NodeType::Array:
+            writeNodes(dynamic_cast<ArrayNode*>(node)->GetArray());
+            break;
+        case NodeType::VarAssign:
+        {
+            VariableAssignmentNode* varAssignNode = dynamic_cast<VariableAssignmentNode*>(node);
+            writeToken(varAssignNode->GetObject());
+            WriteNode(varAssignNode->GetRight());
+            break;
+        }
+        case NodeType::Identifier:
+        {
+            // Object parents are plain identifier tokens rather than variable retrievals
+            VarRetrievalNode* varRetNode = dynamic_cast<VarRetrievalNode*>(node);
+            WriteByte(varRetNode != NULL);
+            if (varRetNode)
+            {
+                writeToken(varRetNode->GetObject());
+            }
+            break;
+        }
+        case NodeType::If:
+        {
+            IfNode* ifNode = dynamic_cast<IfNode*>(node);
+            WriteNode(ifNode->GetCondition());
+            WriteNode(ifNode->GetIfBlock());
+            WriteNode(ifNode->GetElseBlock());
+            break;
+        }
+        case NodeType::While:
+        {
+            WhileNode* whileNode = dynamic_cast<WhileNode*>(node);
+            WriteNode(whileNode->GetCondition());
+            WriteNode(whileNode->GetBlock());
+            WriteByte(whileNode->IsDoWhile());
+            break;
+        }
+        case NodeType::For:
+        {
+            ForNode* forNode = dynamic_cast<ForNode*>(node);
+            WriteNode(forNode->GetInit());
+            WriteNode(forNode->GetCondition());
+            WriteNode(forNode->GetIncrement());
+            WriteNode(forNode->GetBlock());
+            break;
+        }
+        case NodeType::ForEach:
+        {
+            ForEachNode* forEachNode = dynamic_cast<ForEachNode*>(node);
+            WriteNode(forEachNode->GetArray());
+            WriteNode(forEachNode->GetBlock());
+            break;
+        }
+        case NodeType::ArrayAccess:
+        {
+            ArrayAccessNode* arrayAccessNode = dynamic_cast<ArrayAccessNode*>(node);
+            writeToken(arrayAccessNode->GetObject());
+            WriteNode(arrayAccessNode->GetIndex());
+            break;
+        }
+        case NodeType::ArrayInit:
+        {
+            ArrayInitNode* arrayInitNode = dynamic_cast<ArrayInitNode*>(node);
+            writeToken(arrayInitNode->GetObject());
+            writeNodes(arrayInitNode->GetElements());
+            break;
+        }
+        case NodeType::ArrayAssign:
+        {
+            ArrayAssignmentNode* arrayAssignNode = dynamic_cast<ArrayAssignmentNode*>(node);
+            writeToken(arrayAssignNode->GetObject());
+            WriteNode(arrayAssignNode->GetIndex());
+            WriteNode(arrayAssignNode->GetValue());
+            break;
+        }
+        case NodeType::ArgumentList:
+            writeNodes(dynamic_cast<ArgumentListNode*>(node)->GetArguments());
+            break;
+        case NodeType::FunctionCall:
+        {
+            FunctionCallNode* funcCallNode = dynamic_cast<FunctionCallNode*>(node);
+            writeToken(funcCallNode->GetObject());
+            WriteNode(funcCallNode->GetArguments());
+            break;
+        }
+        case NodeType::Return:
+            WriteNode(dynamic_cast<ReturnNode*>(node)->GetValue());
+            break;
+        case NodeType::FunctionDefinition:
+        {
+            FunctionDefinitionNode* funcDefNode = dynamic_cast<FunctionDefinitionNode*>(node);
+            writeToken(funcDefNode->GetObject());
+            WriteNode(funcDefNode->GetBlock());
+            break;
+        }
+        case NodeType::ObjectDefinition:
+        {
+            ObjectDefinitionNode* objDefNode = dynamic_cast<ObjectDefinitionNode*>(node);
+            writeToken(objDefNode->GetObject());
+            WriteNode(objDefNode->GetBlock());
+            WriteNode(objDefNode->GetParent());
+            break;
+        }
+        default:
+            // Number, String, Break, Continue and Import only carry their token
+            break;
+    }
+}
+
+void AstWriter::WriteByte(unsigned char value)
+{
+    m_data.push_back((char)value);
+}
+
+void AstWriter::WriteUInt32(unsigned int value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        m_data.push_back((char)((value >> (i * 8)) & 0xFF));
+    }
+}
+
+void AstWriter::WriteUInt64(unsigned long long value)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        m_data.push_back((char)((value >> (i * 8)) & 0xFF));
+    }
+}
+
+void AstWriter::WriteString(std::string_view value)
+{
+    WriteUInt32(value.size());
+    m_data.append(value);
+}
+
+void AstWriter::WriteValue(const Value& value)
+{
+    if (value.isNumber())
+    {
+        WriteByte((unsigned char)ValueTag::Number);
+        float number = value.getNumber();
+        unsigned int bits;
+        std::memcpy(&bits, &number, sizeof(bits));
+        WriteUInt32(bits);
+    }
+    else if (value.isString() || value.isPointer())
+    {
+        WriteByte((unsigned char)(value.isString() ? ValueTag::String : ValueTag::ObjectPointer));
+        WriteString(value.getString());
+    }
+    else if (value.isArray())
+    {
+        WriteByte((unsigned char)ValueTag::Array);
+        WriteUInt32(value.size());
+        for (size_t i = 0; i < value.size(); i++)
+        {
+            WriteValue(value[i]);
+        }
+    }
+    else
+    {
+        WriteByte((unsigned char)ValueTag::Null);
+    }
+}
+
+const std::string& AstWriter::GetData() const
+{
+    return m_data;
+}
+
+void AstWriter::SetBaseLocation(SourceLocation baseLocation)
+{
+    m_baseLocation = baseLocation;
+}
+
+void AstWriter::writeToken(const Token& token)
+{
+    WriteByte((unsigned char)token.GetType());
+    WriteString(token.GetValue());
+
+    // Locations are stored relative to the source, with 0 for none
+    unsigned int offset = 0;
+    if (m_baseLocation != NoLocation && token.GetLocation() >= m_baseLocation)
+    {
+        offset = token.GetLocation() - m_baseLocation + 1;
+    }
+    WriteUInt32(offset);
+}
+
+void AstWriter::writeNodes(const std::vector<TokenNode*>& nodes)
+{
+    WriteUInt32(nodes.size());
+    for (TokenNode* node : nodes)
+    {
+        WriteNode(node);
+    }
+}
+
+AstReader::AstReader(const char* data, size_t size)
+    : m_data(data), m_size(size), m_index(0), m_hasError(false), m_baseLocation(NoLocation)
+{
+}
+
+AstReader::~AstReader()
+{
+}
+
+TokenNode* AstReader::ReadNode()
+{
+    unsigned char type = ReadByte();
+    if (m_hasError || type == NullNode)
+    {
+        return NULL;
+    }
+    if (type > (unsigned char)NodeType::Import)
+    {
+        m_hasError = true;
+        return NULL;
+    }
+
+    Token token = readToken();
+    switch ((NodeType)type)
+    {
+        case NodeType::Sequence:
+            return new SequenceNode(token, readNodes());
+        case NodeType::BinaryOperation:
+        {
+            TokenNode* left = ReadNode();
+            TokenNode* right = ReadNode();
+            return new BinaryOperationNode(token, left, right);
+        }
+        case NodeType::UnaryOperation:
+            return new UnaryOperationNode(token, ReadNode());
+        case NodeType::Array:
+            return new ArrayNode(token, readNodes());
+        case NodeType::VarAssign:
+        {
+            Token object = readToken();
+            return new VariableAssignmentNode(token, object, ReadNode());
+        }
+        case NodeType::Identifier:
+        {
+            if (ReadByte())
+            {
+                return new VarRetrievalNode(token, readToken());
+            }
+            return new TokenNode(token, NodeType::Identifier);
+        }
+        case NodeType::If:
+        {
+            TokenNode* condition = ReadNode();
+            TokenNode* ifBlock = ReadNode();
+            TokenNode* elseBlock = ReadNode();
+            return new IfNode(token, condition, ifBlock, elseBlock);
+        }
+        case NodeType::While:
+        {
+            TokenNode* condition = ReadNode();
+            TokenNode* block = ReadNode();
+            bool isDoWhile = ReadByte();
+            return new WhileNode(token, condition, block, isDoWhile);
+        }
+        case NodeType::For:
+        {
+            TokenNode* init = ReadNode();
+            TokenNode* condition = ReadNode();
+            TokenNode* increment = ReadNode();
+            TokenNode* block = ReadNode();
+            return new ForNode(token, init, condition, increment, block);
+        }
+        case NodeType::ForEach:
+        {
+            TokenNode* array = ReadNode();
+            TokenNode* block = ReadNode();
+            return new ForEachNode(token, array, block);
+        }
+        case NodeType::ArrayAccess:
+        {
+            Token object = readToken();
+            return new ArrayAccessNode(token, object, ReadNode());
+        }
+        case NodeType::ArrayInit:
+        {
+            Token object = readToken();
+            return new ArrayInitNode(token, object, readNodes());
+        }
+        case NodeType::ArrayAssign:
+        {
+            Token object = readToken();
+            TokenNode* index = ReadNode();
+            TokenNode* value = ReadNode();
+            return new ArrayAssignmentNode(token, object, index, value);
+        }
+        case NodeType::ArgumentList:
+            return new ArgumentListNode(token, readNodes());
+        case NodeType::FunctionCall:
+        {
+            Token object = readToken();
+            return new FunctionCallNode(token, object, ReadNode());
+        }
+        case NodeType::Return:
+            return new ReturnNode(token, ReadNode());
+        case NodeType::FunctionDefinition:
+        {
+            Token object = readToken();
+            return new FunctionDefinitionNode(token, object, ReadNode());
+        }
+        case NodeType::ObjectDefinition:
+        {
+            Token object = readToken();
+            TokenNode* block = ReadNode();
+            TokenNode* parent = ReadNode();
+            return new ObjectDefinitionNode(token, object, block, parent);
+        }
+        case NodeType::Import:
+            return new ImportNode(token);
+        default:
+            return new TokenNode(token, (NodeType)type);
+    }
+}
+
+unsigned char AstReader::ReadByte()
+{
+    if (!canRead(1))
+    {
+        return 0;
+    }
+    return (unsigned char)m_data[m_index++];
+}
+
+unsigned int AstReader::ReadUInt32()
+{
+    if (!canRead(4))
+    {
+        return 0;
+    }
+    unsigned int value = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        value |= (unsigned int)(unsigned char)m_data[m_index++] << (i * 8);
+    }
+    return value;
+}
+
+unsigned long long AstReader::ReadUInt64()
+{
+    if (!canRead(8))
+    {
+        return 0;
+    }
+    unsigned long long value = 0;
+    for (int i = 0; i < 8; i++)
+    {
+        value |= (unsigned long long)(unsigned char)m_data[m_index++] << (i * 8);
+    }
+    return value;
+}
+
+std::string_view AstReader::ReadString()
+{
+    unsigned int size = ReadUInt32();
+    if (!canRead(size))
+    {
+        return "";
+    }
+    std::string_view value(m_data + m_index, size);
+    m_index += size;
+    return value;
+}
+
+Value AstReader::ReadValue()
+{
+    switch ((ValueTag)ReadByte())
+    {
+        case ValueTag::Number:
+        {
+            unsigned int bits = ReadUInt32();
+            float number;
+            std::memcpy(&number, &bits, sizeof(number));
+            return Value(number);
+        }
+        case ValueTag::String:
+            return Value(std::string(ReadString()));
+        case ValueTag::ObjectPointer:
+            return Value(std::string(ReadString()), false);
+        case ValueTag::Array:
+        {
+            unsigned int count = ReadUInt32();
+            std::vector<Value> array;
+            for (unsigned int i = 0; i < count && !m_hasError; i++)
+            {
+                array.push_back(ReadValue());
+            }
+            return Value(std::move(array));
+        }
+        case ValueTag::Null:
+            return Value();
+        default:
+            m_hasError = true;
+            return Value();
+    }
+}
+
+bool AstReader::HasError() const
+{
+    return m_hasError;
+}
+
+bool AstReader::AtEnd() const
+{
+    return m_index == m_size;
+}
+
+void AstReader::SetBaseLocation(SourceLocation baseLocation)
+{
+    m_baseLocation = baseLocation;
+}
+
+bool AstReader::canRead(size_t size)
+{
+    if (m_hasError || m_size - m_index < size)
+    {
+        m_hasError = true;
+        return false;
+    }
+    return true;
+}
+
+Token AstReader::readToken()
+{
+    Token::Type type = (Token::Type)ReadByte();
+    std::string_view value = ReadString();
+    unsigned int offset = ReadUInt32();
+    if (offset == 0 || m_baseLocation == NoLocation)
+    {
+        return Token(type, value);
+    }
+    return Token(type, value, m_baseLocation + offset - 1);
+}
+
+std::vector<TokenNode*> AstReader::readNodes()
+{
+    unsigned int count = ReadUInt32();
+    std::vector<TokenNode*> nodes;
+    for (unsigned int i = 0; i < count && !m_hasError; i++)
+    {
+        nodes.push_back(ReadNode());
+    }
+    return nodes;
+}
\ No newline at end of file
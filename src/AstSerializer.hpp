@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Token.hpp"
+#include "TokenNode.hpp"
+#include "Value.hpp"
+
+// Compact binary form of a parsed tree, used to skip the lexer and parser for cached modules
+class AstWriter
+{
+public:
+    // Token locations are written relative to the base location of the tree's source
+    AstWriter(SourceLocation baseLocation = NoLocation);
+    ~AstWriter();
+
+    void WriteNode(TokenNode* node);
+
+    void WriteByte(unsigned char value);
+    void WriteUInt32(unsigned int value);
+    void WriteUInt64(unsigned long long value);
+    void WriteString(std::string_view value);
+    // Numbers, strings, arrays, object pointers and null, for snapshots
+    void WriteValue(const Value& value);
+
+    const std::string& GetData() const;
+
+    void SetBaseLocation(SourceLocation baseLocation);
+
+private:
+    std::string m_data;
+    SourceLocation m_baseLocation;
+
+    void writeToken(const Token& token);
+    void writeNodes(const std::vector<TokenNode*>& nodes);
+};
+
+// Token values view into the data, so it must outlive the trees that are read
+class AstReader
+{
+public:
+    AstReader(const char* data, size_t size);
+    ~AstReader();
+
+    // Returns NULL and sets the error flag if the data is truncated or malformed
+    TokenNode* ReadNode();
+
+    unsigned char ReadByte();
+    unsigned int ReadUInt32();
+    unsigned long long ReadUInt64();
+    std::string_view ReadString();
+    Value ReadValue();
+
+    bool HasError() const;
+    bool AtEnd() const;
+
+    // Stored token locations are relative to this, and dropped if it is NoLocation
+    void SetBaseLocation(SourceLocation baseLocation);
+
+private:
+    const char* m_data;
+    size_t m_size;
+    size_t m_index;
+    bool m_hasError;
+    SourceLocation m_baseLocation;
+
+    bool canRead(size_t size);
+    Token readToken();
+    std::vector<TokenNode*> readNodes();
+};
\ No newline at end of file
@@ -0,0 +1,146 @@
+#include "BatchCompiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <system_error>
+#include <thread>
+
+#include "Error.hpp"
+#include "Lexer.hpp"
+#include "ModuleCache.hpp"
+#include "Parser.hpp"
+#include "SourceFile.hpp"
+
+BatchCompiler::BatchCompiler(Mode mode, ModuleCache& moduleCache)
+    : m_mode(mode), m_moduleCache(moduleCache), m_threadCount(0)
+{
+}
+
+BatchCompiler::~BatchCompiler()
+{
+}
+
+bool BatchCompiler::AddPath(const std::string& path)
+{
+    std::error_code error;
+    if (!std::filesystem::is_directory(path, error))
+    {
+        if (!std::filesystem::exists(path, error))
+        {
+            return false;
+        }
+        m_results.push_back({ path, false, {}, 0.0 });
+        return true;
+    }
+
+    // Directory order isn't defined, so sort to keep the report stable between runs
+    std::vector<std::string> paths;
+    for (std::filesystem::recursive_directory_iterator it(path, error), end; !error && it != end; it.increment(error))
+    {
+        if (it->is_regular_file(error) && it->path().extension() == ".txt")
+        {
+            paths.push_back(it->path().string());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+    for (const std::string& file : paths)
+    {
+        m_results.push_back({ file, false, {}, 0.0 });
+    }
+    return true;
+}
+
+size_t BatchCompiler::GetFileCount() const
+{
+    return m_results.size();
+}
+
+void BatchCompiler::SetThreadCount(unsigned int threadCount)
+{
+    m_threadCount = threadCount;
+}
+
+unsigned int BatchCompiler::Run()
+{
+    unsigned int threadCount = m_threadCount;
+    if (threadCount == 0)
+    {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threadCount = (unsigned int)std::min<size_t>(threadCount, std::max<size_t>(1, m_results.size()));
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // Each worker takes the next file until there are none left
+    std::atomic<size_t> nextFile(0);
+    auto work = [this, &nextFile]()
+    {
+        for (size_t i = nextFile++; i < m_results.size(); i = nextFile++)
+        {
+            processFile(m_results[i]);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (unsigned int i = 1; i < threadCount; i++)
+    {
+        workers.emplace_back(work);
+    }
+    work();
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+
+    unsigned int failed = 0;
+    double totalMilliseconds = 0.0;
+    for (const Result& result : m_results)
+    {
+        std::cout << (result.isValid ? "OK   " : "FAIL ") << result.path << " (" << result.milliseconds << "ms)\n";
+        for (const std::string& error : result.errors)
+        {
+            std::cout << "    " << error << '\n';
+        }
+        failed += !result.isValid;
+        totalMilliseconds += result.milliseconds;
+    }
+
+    double wallMilliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+    std::cout << (m_mode == Mode::Compile ? "Compiled " : "Verified ") << m_results.size() << " files, " << failed << " failed\n";
+    std::cout << "Time: " << wallMilliseconds << "ms on " << threadCount << " threads (" << totalMilliseconds << "ms across files)\n";
+    return failed;
+}
+
+void BatchCompiler::processFile(Result& result)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    const SourceFile* source = SourceFile::Load(result.path);
+    if (source == nullptr)
+    {
+        result.errors.push_back("Failed to open file.");
+    }
+    else
+    {
+        Lexer lexer(source);
+        Parser parser(lexer);
+        TokenNode* node = parser.Parse();
+        for (const Error& error : parser.GetErrors())
+        {
+            result.errors.push_back(error.ToString());
+        }
+
+        result.isValid = node != NULL;
+        if (result.isValid && m_mode == Mode::Compile)
+        {
+            m_moduleCache.Store(result.path, source, node);
+        }
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    result.milliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+class ModuleCache;
+
+// Lexes and parses many scripts across a pool of threads. Verify only checks them,
+// Compile also writes each one's module cache entry so later imports skip the parser.
+class BatchCompiler
+{
+public:
+    enum class Mode
+    {
+        Verify,
+        Compile
+    };
+
+    BatchCompiler(Mode mode, ModuleCache& moduleCache);
+    ~BatchCompiler();
+
+    // Directories are searched recursively for .txt scripts. Returns false if the path doesn't exist.
+    bool AddPath(const std::string& path);
+    size_t GetFileCount() const;
+
+    // 0 uses one thread per core
+    void SetThreadCount(unsigned int threadCount);
+
+    // Prints a result for each file, in the order they were added, followed by the totals.
+    // Returns the number of files that failed.
+    unsigned int Run();
+
+private:
+    struct Result
+    {
+        std::string path;
+        bool isValid;
+        std::vector<std::string> errors;
+        double milliseconds;
+    };
+
+    Mode m_mode;
+    ModuleCache& m_moduleCache;
+    unsigned int m_threadCount;
+    std::vector<Result> m_results;
+
+    void processFile(Result& result);
+};
\ No newline at end of file
@@ -0,0 +1,223 @@
+#include "Benchmark.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#include "Error.hpp"
+#include "Interpreter.hpp"
+#include "Lexer.hpp"
+#include "Parser.hpp"
+#include "SourceFile.hpp"
+
+// Writes text as a JSON string, quotes included
+static void WriteJsonString(std::ostream& stream, const std::string& text)
+{
+    stream << '"';
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            stream << '\\' << c;
+        }
+        else if ((unsigned char)c < 0x20)
+        {
+            stream << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c << std::dec << std::setfill(' ');
+        }
+        else
+        {
+            stream << c;
+        }
+    }
+    stream << '"';
+}
+
+static long long Nanoseconds(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+}
+
+Benchmark::Benchmark()
+    : m_warmupRuns(1), m_runs(10), m_snapshotPath("")
+{
+}
+
+Benchmark::~Benchmark()
+{
+}
+
+void Benchmark::SetWarmupRuns(unsigned int warmupRuns)
+{
+    m_warmupRuns = warmupRuns;
+}
+
+void Benchmark::SetRuns(unsigned int runs)
+{
+    m_runs = std::max(1u, runs);
+}
+
+void Benchmark::SetSnapshot(const std::string& path)
+{
+    m_snapshotPath = path;
+}
+
+bool Benchmark::Run(const SourceFile* source, Interpreter& interpreter)
+{
+    m_sourceName = source->GetName();
+    m_phases = { { "lex", {} }, { "parse", {}, true }, { "execute", {} }, { "total", {} } };
+
+    for (unsigned int run = 0; run < m_warmupRuns + m_runs; run++)
+    {
+        if (!m_snapshotPath.empty() && !interpreter.RestoreSnapshot(m_snapshotPath))
+        {
+            std::cout << "Invalid snapshot " << m_snapshotPath << '\n';
+            return false;
+        }
+
+        auto parseStart = std::chrono::steady_clock::now();
+        Lexer lexer(source);
+        Parser parser(lexer);
+        TokenNode* node = parser.Parse();
+        auto parseEnd = std::chrono::steady_clock::now();
+
+        if (node == NULL)
+        {
+            for (const Error& error : parser.GetErrors())
+            {
+                std::cout << error.ToString() << '\n';
+            }
+            return false;
+        }
+
+        interpreter.PreloadModules(node);
+        interpreter.Interpret(node);
+        auto executeEnd = std::chrono::steady_clock::now();
+        interpreter.Reset();
+
+        // The parser pulls tokens as it goes, so lexing is timed again on its own, and the parse
+        // phase is what parsing adds on top of it. That's only approximate, since the two passes differ.
+        auto lexStart = std::chrono::steady_clock::now();
+        Lexer tokenLexer(source);
+        while (tokenLexer.NextToken().GetType() != Token::Type::EndOfFile)
+        {
+        }
+        auto lexEnd = std::chrono::steady_clock::now();
+
+        if (run < m_warmupRuns)
+        {
+            continue;
+        }
+
+        long long lexTime = Nanoseconds(lexStart, lexEnd);
+        m_phases[0].samples.push_back(lexTime);
+        m_phases[1].samples.push_back(std::max(0LL, Nanoseconds(parseStart, parseEnd) - lexTime));
+        m_phases[2].samples.push_back(Nanoseconds(parseEnd, executeEnd));
+        m_phases[3].samples.push_back(Nanoseconds(parseStart, executeEnd));
+    }
+    return true;
+}
+
+void Benchmark::PrintSummary(std::ostream& stream) const
+{
+    stream << "Runs: " << m_runs << " (after " << m_warmupRuns << " warmup)\n";
+    stream << std::fixed << std::setprecision(3);
+    for (const Phase& phase : m_phases)
+    {
+        stream << std::left << std::setw(8) << phase.name << std::right
+               << " mean " << phase.Mean() / 1e6 << "ms, median " << phase.Median() / 1e6
+               << "ms, p95 " << phase.Percentile(95) / 1e6 << "ms, stddev " << phase.StandardDeviation() / 1e6 << "ms"
+               << (phase.isApproximate ? " (approximate)" : "") << '\n';
+    }
+    stream << "parse is lex and parse together less a separate lex pass, so it is approximate\n";
+    stream << std::defaultfloat << std::setprecision(6);
+}
+
+bool Benchmark::WriteJson(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    file << "{\n  \"source\": ";
+    WriteJsonString(file, m_sourceName);
+    file << ",\n  \"warmup\": " << m_warmupRuns << ",\n  \"runs\": " << m_runs << ",\n  \"unit\": \"ns\",\n  \"phases\": {\n";
+    file << std::fixed << std::setprecision(1);
+    for (size_t i = 0; i < m_phases.size(); i++)
+    {
+        const Phase& phase = m_phases[i];
+        file << "    \"" << phase.name << "\": { \"mean\": " << phase.Mean() << ", \"median\": " << phase.Median()
+             << ", \"p95\": " << phase.Percentile(95) << ", \"stddev\": " << phase.StandardDeviation()
+             << ", \"approximate\": " << (phase.isApproximate ? "true" : "false") << ", \"samples\": [";
+        for (size_t j = 0; j < phase.samples.size(); j++)
+        {
+            file << (j ? ", " : "") << phase.samples[j];
+        }
+        file << "] }" << (i + 1 < m_phases.size() ? "," : "") << '\n';
+    }
+    file << "  }\n}\n";
+    file.close();
+    return !file.fail();
+}
+
+const std::vector<Benchmark::Phase>& Benchmark::GetPhases() const
+{
+    return m_phases;
+}
+
+double Benchmark::Phase::Mean() const
+{
+    if (samples.empty())
+    {
+        return 0.0;
+    }
+    double total = 0.0;
+    for (long long sample : samples)
+    {
+        total += sample;
+    }
+    return total / samples.size();
+}
+
+double Benchmark::Phase::Median() const
+{
+    if (samples.empty())
+    {
+        return 0.0;
+    }
+    std::vector<long long> sorted = samples;
+    std::sort(sorted.begin(), sorted.end());
+    size_t middle = sorted.size() / 2;
+    return sorted.size() % 2 ? sorted[middle] : (sorted[middle - 1] + sorted[middle]) / 2.0;
+}
+
+long long Benchmark::Phase::Percentile(unsigned int percent) const
+{
+    if (samples.empty())
+    {
+        return 0;
+    }
+    std::vector<long long> sorted = samples;
+    std::sort(sorted.begin(), sorted.end());
+    size_t rank = (sorted.size() * percent + 99) / 100;
+    return sorted[std::max<size_t>(rank, 1) - 1];
+}
+
+double Benchmark::Phase::StandardDeviation() const
+{
+    if (samples.size() < 2)
+    {
+        return 0.0;
+    }
+    double mean = Mean();
+    double total = 0.0;
+    for (long long sample : samples)
+    {
+        total += (sample - mean) * (sample - mean);
+    }
+    return std::sqrt(total / (samples.size() - 1));
+}
\ No newline at end of file
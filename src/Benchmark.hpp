@@ -0,0 +1,52 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+class Interpreter;
+class SourceFile;
+
+// Runs a script repeatedly, each time from an empty interpreter, and times its phases.
+// Warmup runs aren't measured. Times are kept in nanoseconds.
+class Benchmark
+{
+public:
+    struct Phase
+    {
+        std::string name;
+        std::vector<long long> samples;
+        // Worked out from other timings rather than timed on its own
+        bool isApproximate = false;
+
+        double Mean() const;
+        double Median() const;
+        // Nearest rank, so it's always one of the samples
+        long long Percentile(unsigned int percent) const;
+        // Sample standard deviation, 0 for a single run
+        double StandardDeviation() const;
+    };
+
+    Benchmark();
+    ~Benchmark();
+
+    void SetWarmupRuns(unsigned int warmupRuns);
+    void SetRuns(unsigned int runs);
+    // Each run starts from this snapshot instead, restored outside the timed phases
+    void SetSnapshot(const std::string& path);
+
+    // Returns false, after printing its syntax errors, if the source doesn't parse
+    bool Run(const SourceFile* source, Interpreter& interpreter);
+
+    void PrintSummary(std::ostream& stream) const;
+    bool WriteJson(const std::string& path) const;
+    // Lex, parse, execute and their total, from the last Run
+    const std::vector<Phase>& GetPhases() const;
+
+private:
+    unsigned int m_warmupRuns;
+    unsigned int m_runs;
+    std::string m_snapshotPath;
+    std::string m_sourceName;
+    std::vector<Phase> m_phases;
+};
\ No newline at end of file
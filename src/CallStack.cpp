@@ -0,0 +1,102 @@
+#include "CallStack.hpp"
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+static size_t GetNativeStackBudget()
+{
+    // Leave a quarter of the stack for builtins and the host
+    size_t stackSize = 1024 * 1024;
+#ifndef _WIN32
+    struct rlimit limit;
+    if (getrlimit(RLIMIT_STACK, &limit) == 0)
+    {
+        if (limit.rlim_cur == RLIM_INFINITY)
+        {
+            stackSize = 64 * 1024 * 1024;
+        }
+        else
+        {
+            stackSize = limit.rlim_cur;
+        }
+    }
+#endif
+    return stackSize / 4 * 3;
+}
+
+CallStack::CallStack(unsigned int maxDepth)
+    : m_maxDepth(maxDepth), m_nativeStackBase(nullptr), m_nativeStackBudget(GetNativeStackBudget())
+{
+}
+
+CallStack::~CallStack()
+{
+}
+
+bool CallStack::Push(const CallFrame& frame)
+{
+    if (m_frames.size() >= m_maxDepth)
+    {
+        return false;
+    }
+
+    m_frames.push_back(frame);
+    return true;
+}
+
+void CallStack::Pop()
+{
+    m_frames.pop_back();
+}
+
+CallFrame& CallStack::Top()
+{
+    return m_frames.back();
+}
+
+bool CallStack::IsEmpty() const
+{
+    return m_frames.empty();
+}
+
+unsigned int CallStack::GetDepth() const
+{
+    return m_frames.size();
+}
+
+const std::vector<CallFrame>& CallStack::GetFrames() const
+{
+    return m_frames;
+}
+
+void CallStack::SetMaxDepth(unsigned int maxDepth)
+{
+    m_maxDepth = maxDepth;
+}
+
+unsigned int CallStack::GetMaxDepth() const
+{
+    return m_maxDepth;
+}
+
+void CallStack::SetNativeStackBase(const char* base)
+{
+    m_nativeStackBase = base;
+}
+
+bool CallStack::HasNativeStackRoom(const char* current) const
+{
+    if (m_nativeStackBase == nullptr)
+    {
+        return true;
+    }
+
+    size_t used = current < m_nativeStackBase ? m_nativeStackBase - current : current - m_nativeStackBase;
+    return used < m_nativeStackBudget;
+}
+
+void CallStack::Clear()
+{
+    m_frames.clear();
+}
\ No newline at end of file
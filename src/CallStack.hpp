@@ -0,0 +1,66 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Value.hpp"
+
+class SymbolTable;
+class TokenNode;
+
+// A call waiting to replace the frame that issued it (return f(...);)
+struct TailCall
+{
+    bool pending = false;
+    std::string functionName;
+    SymbolTable* parentScope = nullptr;
+    TokenNode* body = nullptr;
+    std::vector<Value> args;
+    // The callee runs in the replaced call's scope rather than a new one beneath parentScope
+    bool keepsScope = false;
+};
+
+struct CallFrame
+{
+    std::string functionName;
+    SymbolTable* parentScope = nullptr;
+    SymbolTable* scope = nullptr;
+    std::string scopeName;
+    TokenNode* body = nullptr;
+    std::vector<Value> args;
+    TailCall tailCall;
+};
+
+class CallStack
+{
+public:
+    static const unsigned int DefaultMaxDepth = 1000;
+
+    CallStack(unsigned int maxDepth = DefaultMaxDepth);
+    ~CallStack();
+
+    // Returns false if pushing the frame would exceed the maximum depth
+    bool Push(const CallFrame& frame);
+    void Pop();
+    CallFrame& Top();
+
+    bool IsEmpty() const;
+    unsigned int GetDepth() const;
+    const std::vector<CallFrame>& GetFrames() const;
+
+    void SetMaxDepth(unsigned int maxDepth);
+    unsigned int GetMaxDepth() const;
+
+    // Script calls still recurse natively, so very large depths are also bounded by the host stack
+    void SetNativeStackBase(const char* base);
+    bool HasNativeStackRoom(const char* current) const;
+
+    void Clear();
+
+private:
+    std::vector<CallFrame> m_frames;
+    unsigned int m_maxDepth;
+
+    const char* m_nativeStackBase;
+    size_t m_nativeStackBudget;
+};
\ No newline at end of file
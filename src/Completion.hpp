@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Value.hpp"
+
+// Result of executing a statement. Anything other than Normal unwinds
+// to the construct that handles it (loop, function call or sequence).
+struct Completion
+{
+    enum class Type
+    {
+        Normal,
+        Break,
+        Continue,
+        Return,
+        Error
+    };
+
+    Completion(Type type = Type::Normal, const Value& value = Value())
+        : type(type), value(value)
+    {
+    }
+
+    bool IsAbrupt() const { return type != Type::Normal; }
+
+    Type type;
+    Value value;
+};
\ No newline at end of file
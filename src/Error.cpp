@@ -1,7 +1,12 @@
 #include "Error.hpp"
 
 Error::Error(const std::string& message, const Position& position)
-    : m_message(message), m_position(position)
+    : m_message(message), m_position(position), m_location(NoLocation)
+{
+}
+
+Error::Error(const std::string& message, SourceLocation location)
+    : m_message(message), m_position("", 0, 0, 0), m_location(location)
 {
 }
 
@@ -16,10 +21,20 @@ std::string Error::GetMessage() const
 
 Position Error::GetPosition() const
 {
+    if (m_location != NoLocation)
+    {
+        return SourceMap::Resolve(m_location);
+    }
     return m_position;
 }
 
+SourceLocation Error::GetLocation() const
+{
+    return m_location;
+}
+
 std::string Error::ToString() const
 {
-    return "[" + m_position.GetFileName() + "] ERROR AT (Line: " + std::to_string(m_position.GetLine()) + ", Column: " + std::to_string(m_position.GetColumn()) + " [INDEX: " + std::to_string(m_position.GetIndex()) +  "]): " + m_message;
+    Position position = GetPosition();
+    return "[" + position.GetFileName() + "] ERROR AT (Line: " + std::to_string(position.GetLine()) + ", Column: " + std::to_string(position.GetColumn()) + " [INDEX: " + std::to_string(position.GetIndex()) +  "]): " + m_message;
 }
\ No newline at end of file
@@ -2,19 +2,24 @@
 
 #include <string>
 #include "Position.hpp"
+#include "SourceMap.hpp"
 
 class Error
 {
 public:
     Error(const std::string& message, const Position& position);
+    // The location is only resolved to a file, line and column when the error is reported
+    Error(const std::string& message, SourceLocation location);
     ~Error();
 
     std::string GetMessage() const;
     Position GetPosition() const;
+    SourceLocation GetLocation() const;
 
     std::string ToString() const;
 
 private:
     std::string m_message;
     Position m_position;
+    SourceLocation m_location;
 };
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "Instrumentation.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+
+#include "TokenNode.hpp"
+
+static const unsigned int NodeTypeCount = (unsigned int)NodeType::LazyBlock + 1;
+
+static const char* const s_nodeTypeNames[NodeTypeCount] =
+{
+    "Sequence", "BinaryOperation", "UnaryOperation", "Number", "String", "Array", "VarAssign", "Identifier",
+    "If", "While", "For", "ForEach", "ArrayAccess", "ArrayInit", "ArrayAssign", "ArgumentList", "FunctionCall",
+    "Break", "Continue", "Return", "FunctionDefinition", "ObjectDefinition", "ObjectAssign", "Import", "LazyBlock"
+};
+
+static const char* const s_counterNames[(unsigned int)Instrumentation::Counter::Count] =
+{
+    "Variable lookups", "Function lookups", "Scopes added", "Scopes removed",
+    "Value copies", "Value moves", "Value string allocations", "Value array allocations"
+};
+
+// Parsing can run on several threads, and Values are made there too
+static std::atomic<unsigned long long> s_counters[(unsigned int)Instrumentation::Counter::Count];
+static std::atomic<unsigned long long> s_nodeCounts[NodeTypeCount];
+static std::atomic<unsigned long long> s_nodeNanoseconds[NodeTypeCount];
+
+static thread_local Instrumentation::NodeTimer* t_currentTimer = nullptr;
+
+static long long Now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void Instrumentation::Add(Counter counter)
+{
+    s_counters[(unsigned int)counter].fetch_add(1, std::memory_order_relaxed);
+}
+
+Instrumentation::NodeTimer::NodeTimer(NodeType type, bool isActive)
+    : m_parent(t_currentTimer), m_type((unsigned int)type), m_isActive(isActive), m_start(0), m_childNanoseconds(0)
+{
+    if (m_isActive)
+    {
+        t_currentTimer = this;
+        m_start = Now();
+    }
+}
+
+Instrumentation::NodeTimer::~NodeTimer()
+{
+    if (!m_isActive)
+    {
+        return;
+    }
+
+    long long elapsed = Now() - m_start;
+    s_nodeCounts[m_type].fetch_add(1, std::memory_order_relaxed);
+    s_nodeNanoseconds[m_type].fetch_add(elapsed - m_childNanoseconds, std::memory_order_relaxed);
+    if (m_parent != nullptr)
+    {
+        m_parent->m_childNanoseconds += elapsed;
+    }
+    t_currentTimer = m_parent;
+}
+
+void Instrumentation::PrintSummary(std::ostream& stream)
+{
+    stream << '\n' << std::left << std::setw(18) << "Node" << std::right << std::setw(12) << "Dispatches"
+           << std::setw(18) << "Own time (ms)" << std::setw(13) << "ns/dispatch" << '\n';
+    stream << std::fixed << std::setprecision(3);
+    for (unsigned int i = 0; i < NodeTypeCount; i++)
+    {
+        unsigned long long count = s_nodeCounts[i].load();
+        if (count == 0)
+        {
+            continue;
+        }
+        unsigned long long nanoseconds = s_nodeNanoseconds[i].load();
+        stream << std::left << std::setw(18) << s_nodeTypeNames[i] << std::right << std::setw(12) << count
+               << std::setw(18) << nanoseconds / 1e6 << std::setw(13) << std::setprecision(1) << (double)nanoseconds / count
+               << std::setprecision(3) << '\n';
+    }
+
+    stream << '\n' << std::left << std::setw(26) << "Counter" << std::right << std::setw(12) << "Count" << '\n';
+    for (unsigned int i = 0; i < (unsigned int)Counter::Count; i++)
+    {
+        stream << std::left << std::setw(26) << s_counterNames[i] << std::right << std::setw(12) << s_counters[i].load() << '\n';
+    }
+    stream << std::defaultfloat << std::setprecision(6);
+}
\ No newline at end of file
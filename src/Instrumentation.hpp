@@ -0,0 +1,52 @@
+#pragma once
+
+#include <ostream>
+
+// Counts of what the interpreter does, for finding hot paths. Only built with the PLANETOID_INSTRUMENT
+// CMake option; otherwise the macros below expand to nothing and cost nothing.
+enum class NodeType;
+
+class Instrumentation
+{
+public:
+    enum class Counter
+    {
+        VariableLookup, // one per table searched
+        FunctionLookup, // one per table searched
+        ScopeAdded,
+        ScopeRemoved,
+        ValueCopy,
+        ValueMove,
+        ValueStringAllocation,
+        ValueArrayAllocation,
+        Count
+    };
+
+    static void Add(Counter counter);
+
+    // Times a node from construction to destruction. Time spent in nested nodes
+    // counts towards theirs, so the report shows each node type's own cost.
+    class NodeTimer
+    {
+    public:
+        NodeTimer(NodeType type, bool isActive = true);
+        ~NodeTimer();
+
+    private:
+        NodeTimer* m_parent;
+        unsigned int m_type;
+        bool m_isActive;
+        long long m_start;
+        long long m_childNanoseconds;
+    };
+
+    static void PrintSummary(std::ostream& stream);
+};
+
+#ifdef PLANETOID_INSTRUMENT
+#define PLANETOID_COUNT(counter) Instrumentation::Add(Instrumentation::Counter::counter)
+#define PLANETOID_TIME_NODE(type, isActive) Instrumentation::NodeTimer nodeTimer(type, isActive)
+#else
+#define PLANETOID_COUNT(counter) ((void)0)
+#define PLANETOID_TIME_NODE(type, isActive) ((void)0)
+#endif
\ No newline at end of file
@@ -1,18 +1,31 @@
 #include "Interpreter.hpp"
 
-#include <fstream>
+#include <cmath>
+#include <cstring>
 #include <iostream>
 
-#include "Lexer.hpp"
 #include "Parser.hpp"
+#include "Snapshot.hpp"
+#include "SourceFile.hpp"
 
 #include "Error.hpp"
+#include "Instrumentation.hpp"
 #include "SymbolTable.hpp"
 #include "Value.hpp"
 
+static const unsigned int MaxMemoCapacity = 1 << 24;
+static const unsigned int MaxRandomArraySize = 1 << 24;
+
 Interpreter::Interpreter()
+    : m_loopDepth(0), m_profiler(nullptr), m_tracer(nullptr), m_modulePreloader(m_moduleCache)
 {
     m_currentSymbolTable = &g_symbolTable;
+
+    m_interpreterFunctions["memoize"] = &Interpreter::memoize;
+    m_interpreterFunctions["memostats"] = &Interpreter::memoStats;
+    m_interpreterFunctions["seed"] = &Interpreter::seed;
+    m_interpreterFunctions["random"] = &Interpreter::random;
+    m_interpreterFunctions["randomarray"] = &Interpreter::randomArray;
 }
 
 Interpreter::~Interpreter()
@@ -21,10 +34,19 @@ Interpreter::~Interpreter()
 
 Value Interpreter::Interpret(TokenNode* node)
 {
-    if (node->GetType() == NodeType::Sequence)
+    if (IsStatement(node))
     {
-        return InterpretSequence(node);
+        // Statements used as values, e.g. x = if (...) { ... };
+        Completion completion = Execute(node);
+        if (completion.type == Completion::Type::Break || completion.type == Completion::Type::Continue || completion.type == Completion::Type::Return)
+        {
+            Error e("Control flow statement used inside an expression", node->GetLocation());
+            std::cout << e.ToString() << '\n';
+        }
+        return completion.value;
     }
+
+    PLANETOID_TIME_NODE(node->GetType(), true);
     if (node->GetType() == NodeType::Number)
     {
         return InterpretNumber(node);
@@ -53,22 +75,6 @@ Value Interpreter::Interpret(TokenNode* node)
     {
         return InterpretIdentifier(node);
     }
-    else if (node->GetType() == NodeType::If)
-    {
-        return InterpretIf(node);
-    }
-    else if (node->GetType() == NodeType::While)
-    {
-        return InterpretWhile(node);
-    }
-    else if (node->GetType() == NodeType::For)
-    {
-        return InterpretFor(node);
-    }
-    else if (node->GetType() == NodeType::ForEach)
-    {
-        return InterpretForEach(node);
-    }
     else if (node->GetType() == NodeType::ArrayAccess)
     {
         return InterpretArrayAccess(node);
@@ -85,18 +91,6 @@ Value Interpreter::Interpret(TokenNode* node)
     {
         return InterpretFunctionCall(node);
     }
-    else if (node->GetType() == NodeType::Break)
-    {
-        return InterpretBreak(node);
-    }
-    else if (node->GetType() == NodeType::Continue)
-    {
-        return InterpretContinue(node);
-    }
-    else if (node->GetType() == NodeType::Return)
-    {
-        return InterpretReturn(node);
-    }
     else if (node->GetType() == NodeType::FunctionDefinition)
     {
         return InterpretFunctionDefinition(node);
@@ -111,42 +105,119 @@ Value Interpreter::Interpret(TokenNode* node)
     }
     else
     {
-        Error e("Unknown Node Type: ", Position("Interpreter", 0, 0, 0));
+        Error e("Unknown Node Type: ", node->GetLocation());
         std::cout << e.ToString() << (int)node->GetType() << '\n';
         return Value();
     }
 }
 
-Value Interpreter::InterpretSequence(TokenNode* node)
+bool Interpreter::IsStatement(TokenNode* node) const
 {
-    SequenceNode* seqNode = dynamic_cast<SequenceNode*>(node);
-    Value result = 0;
-    for (int i = 0; i < seqNode->GetNodes().size(); i++)
+    switch (node->GetType())
+    {
+        case NodeType::Sequence:
+        case NodeType::If:
+        case NodeType::While:
+        case NodeType::For:
+        case NodeType::ForEach:
+        case NodeType::Break:
+        case NodeType::Continue:
+        case NodeType::Return:
+            return true;
+        default:
+            return false;
+    }
+}
+
+Completion Interpreter::Execute(TokenNode* node)
+{
+    // Samples go to the statements in a block, not the block
+    if (m_profiler != nullptr && node->GetType() != NodeType::Sequence && node->GetType() != NodeType::LazyBlock)
+    {
+        m_profiler->Poll(node->GetLocation());
+    }
+    // Other nodes are timed by Interpret
+    PLANETOID_TIME_NODE(node->GetType(), IsStatement(node) || node->GetType() == NodeType::LazyBlock);
+
+    switch (node->GetType())
+    {
+        case NodeType::Sequence:
+            return ExecuteSequence(node);
+        case NodeType::If:
+            return ExecuteIf(node);
+        case NodeType::While:
+            return ExecuteWhile(node);
+        case NodeType::For:
+            return ExecuteFor(node);
+        case NodeType::ForEach:
+            return ExecuteForEach(node);
+        case NodeType::Break:
+            return ExecuteBreak(node);
+        case NodeType::Continue:
+            return ExecuteContinue(node);
+        case NodeType::Return:
+            return ExecuteReturn(node);
+        case NodeType::LazyBlock:
+            return ExecuteLazyBlock(node);
+        default:
+            break;
+    }
+
+    Value value = Interpret(node);
+    if (m_state.hasError)
     {
-        result = Interpret(seqNode->GetNodes()[i]);
+        return Completion(Completion::Type::Error);
+    }
+    return Completion(Completion::Type::Normal, value);
+}
 
-        if (m_state.hasError)
+Completion Interpreter::ExecuteSequence(TokenNode* node)
+{
+    SequenceNode* seqNode = dynamic_cast<SequenceNode*>(node);
+    const std::vector<TokenNode*>& nodes = seqNode->GetNodes();
+    Completion result(Completion::Type::Normal, 0);
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        // Freed before the next statement starts, so a profile charges it to the statement that made it
+        result.value = Value();
+        result = Execute(nodes[i]);
+        if (result.IsAbrupt())
         {
             break;
         }
-        if ((m_state.canBreak && m_state.breakCalled) || (m_state.canContinue && m_state.continueCalled) || (m_state.canReturn && m_state.returnCalled))
+    }
+    return result;
+}
+
+Completion Interpreter::ExecuteLazyBlock(TokenNode* node)
+{
+    // Function bodies are parsed the first time they run
+    LazyBlockNode* lazyNode = dynamic_cast<LazyBlockNode*>(node);
+    if (!lazyNode->IsCompiled())
+    {
+        for (const Error& error : Parser::Compile(lazyNode))
         {
-            break;
+            std::cout << error.ToString() << '\n';
         }
     }
-    return result;
+    if (lazyNode->GetBlock() == NULL)
+    {
+        m_state.hasError = true;
+        return Completion(Completion::Type::Error);
+    }
+    return Execute(lazyNode->GetBlock());
 }
 
 Value Interpreter::InterpretNumber(TokenNode* node)
 {
     if (node->GetToken().GetValue() == "")
         return Value();
-    return Value(std::stof(node->GetToken().GetValue()));
+    return Value(std::stof(std::string(node->GetToken().GetValue())));
 }
 
 Value Interpreter::InterpretString(TokenNode* node)
 {
-    return Value(node->GetToken().GetValue());
+    return Value(std::string(node->GetToken().GetValue()));
 }
 
 Value Interpreter::InterpretArray(TokenNode* node)
@@ -184,7 +255,7 @@ Value Interpreter::InterpretBinaryOperation(TokenNode* node)
     {
         if (right.getNumber() == 0 || !right.isNumber())
         {
-            Error e("Division by zero: ", Position("", 0, 0, 0));
+            Error e("Division by zero: ", node->GetLocation());
             std::cout << e.ToString() << '\n';
             return Value();
         }
@@ -228,7 +299,7 @@ Value Interpreter::InterpretBinaryOperation(TokenNode* node)
     }
     else
     {
-        Error e("Unknown Binary Operation: ", Position("", 0, 0, 0));
+        Error e("Unknown Binary Operation: ", node->GetLocation());
         std::cout << e.ToString() << (int)token.GetType() << '\n';
         return Value();
     }
@@ -253,7 +324,7 @@ Value Interpreter::InterpretUnaryOperation(TokenNode* node)
     }
     else
     {
-        Error e("Unknown Unary Operation: ", Position("", 0, 0, 0));
+        Error e("Unknown Unary Operation: ", node->GetLocation());
         std::cout << e.ToString() << (int)token.GetType() << '\n';
         return Value();
     }
@@ -273,38 +344,39 @@ Value Interpreter::InterpretVarAssign(TokenNode* node)
 
         SymbolTable* scope = m_currentSymbolTable;
         Token s = funcCallNode->GetObject();
-        std::vector<std::string> scopeNames = SplitString(s.GetValue());
+        std::vector<std::string> scopeNames = SplitString(std::string(s.GetValue()));
         
         if (s.GetType() == Token::Type::Identifier)
         {
             for (size_t i = 0; i < scopeNames.size(); i++)
             {
-                if (m_currentSymbolTable->ObjectExists(s.GetValue(), "", true))
+                if (m_currentSymbolTable->ObjectExists(std::string(s.GetValue()), "", true))
                 {
-                    scope = m_currentSymbolTable->GetScope(m_currentSymbolTable->GetObjectScopeName(s.GetValue()));
+                    scope = m_currentSymbolTable->GetScope(m_currentSymbolTable->GetObjectScopeName(std::string(s.GetValue())));
                 }
-                else if (g_symbolTable.ModuleExists(s.GetValue()))
+                else if (g_symbolTable.ModuleExists(std::string(s.GetValue())))
                 {
-                    scope = g_symbolTable.GetModule(s.GetValue());
+                    scope = g_symbolTable.GetModule(std::string(s.GetValue()));
                     module = s.GetValue();
                 }
                 else
                 {
-                    Error e("Object does not exist: ", Position("Interpreter", 0, 0, 0));
+                    Error e("Object does not exist: ", node->GetLocation());
                     std::cout << e.ToString() << s.GetValue() << '\n';
                     return Value();
                 }
             }
         }
 
-        if (scope->ObjectExists(obj.GetValue(), module, true))
+        if (scope->ObjectExists(std::string(obj.GetValue()), module, true))
         {
-            m_currentSymbolTable->AddObjectInstance(token.GetValue(), obj.GetValue(), module);
+            Tracer::Scope trace(m_tracer, Tracer::Category::Instance, obj.GetValue(), node->GetLocation());
+            m_currentSymbolTable->AddObjectInstance(std::string(token.GetValue()), std::string(obj.GetValue()), module);
 
-            // Call init function
-            std::string instScopeName = scope->GetObjectInstanceScopeName(obj.GetValue());
-            SymbolTable* instScope = scope->GetScope(instScopeName);
-            SymbolTable* currentScope = m_currentSymbolTable;
+            // Call init function. The instance was added to the current scope, which inside a block or
+            // function isn't the one holding the object's definition.
+            std::string instScopeName = m_currentSymbolTable->GetObjectInstanceScopeName(std::string(token.GetValue()), false);
+            SymbolTable* instScope = m_currentSymbolTable->GetScope(instScopeName);
 
             if (instScope->IsUserFunction("init"))
             {
@@ -321,7 +393,7 @@ Value Interpreter::InterpretVarAssign(TokenNode* node)
     if (varAssignNode->GetObject().GetType() == Token::Type::Identifier)
     {
         Token object = varAssignNode->GetObject();
-        std::vector<std::string> scopeNames = SplitString(object.GetValue());
+        std::vector<std::string> scopeNames = SplitString(std::string(object.GetValue()));
         SymbolTable* scope = m_currentSymbolTable;
         for (size_t i = 0; i < scopeNames.size(); i++)
         {
@@ -336,16 +408,16 @@ Value Interpreter::InterpretVarAssign(TokenNode* node)
             }
             else
             {
-                Error e("Unknown Object Instance: ", Position("", 0, 0, 0));
+                Error e("Unknown Object Instance: ", node->GetLocation());
                 std::cout << e.ToString() << object.GetValue() << '\n';
                 return Value();
             }
         }
-        scope->RegisterVar(token.GetValue(), right);
+        scope->RegisterVar(std::string(token.GetValue()), right);
     }
     else
     {
-        m_currentSymbolTable->RegisterVar(token.GetValue(), right);
+        m_currentSymbolTable->RegisterVar(std::string(token.GetValue()), right);
     }
 
     return right;
@@ -361,7 +433,7 @@ Value Interpreter::InterpretIdentifier(TokenNode* node)
     Token object = varRetNode->GetObject();
     if (object.GetType() == Token::Type::Identifier)
     {
-        std::string objectName = object.GetValue();
+        std::string objectName(object.GetValue());
         if (symbolTable->VarExists(objectName))
         {
             Value var = symbolTable->GetVar(objectName, false);
@@ -384,7 +456,7 @@ Value Interpreter::InterpretIdentifier(TokenNode* node)
             }
             else
             {
-                Error e("Unknown Object Instance: ", Position("", 0, 0, 0));
+                Error e("Unknown Object Instance: ", node->GetLocation());
                 std::cout << e.ToString() << scopeNames[i] << '\n';
                 return Value();
             }
@@ -393,36 +465,41 @@ Value Interpreter::InterpretIdentifier(TokenNode* node)
         searchGlobal = false;
     }
 
-    if (symbolTable->VarExists(token.GetValue(), searchGlobal))
+    if (symbolTable->VarExists(std::string(token.GetValue()), searchGlobal))
     {
-        return symbolTable->GetVar(token.GetValue(), searchGlobal);
+        return symbolTable->GetVar(std::string(token.GetValue()), searchGlobal);
     }
-    else if (symbolTable->ObjectInstanceExists(token.GetValue(), searchGlobal))
+    else if (symbolTable->ObjectInstanceExists(std::string(token.GetValue()), searchGlobal))
     {
-        std::string varPath = token.GetValue();
+        std::string varPath(token.GetValue());
         if (object.GetType() == Token::Type::Identifier)
         {
-            varPath = object.GetValue() + "." + token.GetValue();
+            varPath = std::string(object.GetValue()) + "." + std::string(token.GetValue());
         }
         return Value(varPath, false);
     }
 
-    Error e("Unknown Identifier: ", Position("Interpreter", 0, 0, 0));
+    Error e("Unknown Identifier: ", node->GetLocation());
     std::cout << e.ToString() << token.GetValue() << '\n';
     return Value();
 }
 
-Value Interpreter::InterpretIf(TokenNode* node)
+Completion Interpreter::ExecuteIf(TokenNode* node)
 {
     IfNode* ifNode = dynamic_cast<IfNode*>(node);
     Value condition = Interpret(ifNode->GetCondition());
+    if (m_state.hasError)
+    {
+        return Completion(Completion::Type::Error);
+    }
+
     if (condition != 0)
     {
         unsigned int scopeCount = m_currentSymbolTable->GetScopeCount();
         m_currentSymbolTable->AddScope("IfBlock" + std::to_string(scopeCount));
         m_currentSymbolTable = m_currentSymbolTable->GetScope("IfBlock" + std::to_string(scopeCount));
 
-        Value n = Interpret(ifNode->GetIfBlock());
+        Completion n = Execute(ifNode->GetIfBlock());
         m_currentSymbolTable = m_currentSymbolTable->GetParentScope();
         m_currentSymbolTable->RemoveScope("IfBlock" + std::to_string(scopeCount));
 
@@ -436,186 +513,135 @@ Value Interpreter::InterpretIf(TokenNode* node)
             m_currentSymbolTable->AddScope("ElseBlock" + std::to_string(scopeCount));
             m_currentSymbolTable = m_currentSymbolTable->GetScope("ElseBlock" + std::to_string(scopeCount));
 
-            Value n = Interpret(ifNode->GetElseBlock());
+            Completion n = Execute(ifNode->GetElseBlock());
             m_currentSymbolTable = m_currentSymbolTable->GetParentScope();
             m_currentSymbolTable->RemoveScope("ElseBlock" + std::to_string(scopeCount));
 
             return n;
         }
-        return Value();
+        return Completion();
+    }
+}
+
+bool Interpreter::ExitsLoop(const Completion& body, Completion& result) const
+{
+    if (body.type == Completion::Type::Return || body.type == Completion::Type::Error)
+    {
+        result = body;
+        return true;
     }
+
+    result.value = body.value;
+    return body.type == Completion::Type::Break;
 }
 
-Value Interpreter::InterpretWhile(TokenNode* node)
+Completion Interpreter::ExecuteWhile(TokenNode* node)
 {
     WhileNode* whileNode = dynamic_cast<WhileNode*>(node);
-    Value condition = Interpret(whileNode->GetCondition());
-    Value result(0);
+    Completion result(Completion::Type::Normal, 0);
+    Tracer::Scope trace(m_tracer, Tracer::Category::Loop, whileNode->IsDoWhile() ? "do while" : "while", node->GetLocation());
 
     unsigned int scopeCount = m_currentSymbolTable->GetScopeCount();
     m_currentSymbolTable->AddScope("WhileLoop" + std::to_string(scopeCount));
     m_currentSymbolTable = m_currentSymbolTable->GetScope("WhileLoop" + std::to_string(scopeCount));
 
-    bool retainContinue = m_state.canContinue;
-    bool retainBreak = m_state.canBreak;
+    m_loopDepth++;
 
-    m_state.canContinue = true;
-    m_state.canBreak = true;
-
-    if (whileNode->IsDoWhile())
+    // A do-while runs its block once before the condition is checked
+    bool runBlock = whileNode->IsDoWhile();
+    while (runBlock || Interpret(whileNode->GetCondition()) != 0)
     {
-        do
+        runBlock = false;
+        if (ExitsLoop(Execute(whileNode->GetBlock()), result))
         {
-            result = Interpret(whileNode->GetBlock());
-            condition = Interpret(whileNode->GetCondition());
-            if (m_state.breakCalled)
-            {
-                m_state.breakCalled = false;
-                break;
-            }
-            if (m_state.continueCalled)
-            {
-                m_state.continueCalled = false;
-                continue;
-            }
-        } while (condition != 0);
-    }
-    else
-    {
-        while (condition != 0)
-        {
-            result = Interpret(whileNode->GetBlock());
-            condition = Interpret(whileNode->GetCondition());
-            if (m_state.breakCalled)
-            {
-                m_state.breakCalled = false;
-                break;
-            }
-            if (m_state.continueCalled)
-            {
-                m_state.continueCalled = false;
-                continue;
-            }
+            break;
         }
     }
 
+    m_loopDepth--;
+
     m_currentSymbolTable = m_currentSymbolTable->GetParentScope();
     m_currentSymbolTable->RemoveScope("WhileLoop" + std::to_string(scopeCount));
 
-    m_state.canContinue = retainContinue;
-    m_state.canBreak = retainBreak;
-
     return result;
 }
 
-Value Interpreter::InterpretFor(TokenNode* node)
+Completion Interpreter::ExecuteFor(TokenNode* node)
 {
     ForNode* forNode = dynamic_cast<ForNode*>(node);
+    Tracer::Scope trace(m_tracer, Tracer::Category::Loop, "for", node->GetLocation());
     unsigned int scopeCount = m_currentSymbolTable->GetScopeCount();
     m_currentSymbolTable->AddScope("ForLoop" + std::to_string(scopeCount));
     m_currentSymbolTable = m_currentSymbolTable->GetScope("ForLoop" + std::to_string(scopeCount));
 
-    Value result(0);
+    Completion result(Completion::Type::Normal, 0);
 
-    Value init = Interpret(forNode->GetInit());
-    Value condition = Interpret(forNode->GetCondition());
+    Interpret(forNode->GetInit());
 
-    bool retainContinue = m_state.canContinue;
-    bool retainBreak = m_state.canBreak;
+    m_loopDepth++;
 
-    m_state.canContinue = true;
-    m_state.canBreak = true;
-
-    while (condition != 0)
+    while (Interpret(forNode->GetCondition()) != 0)
     {
-        result = Interpret(forNode->GetBlock());
-        Value increment = Interpret(forNode->GetIncrement());
-        condition = Interpret(forNode->GetCondition());
-        if (m_state.breakCalled)
+        if (ExitsLoop(Execute(forNode->GetBlock()), result))
         {
-            m_state.breakCalled = false;
             break;
         }
-        if (m_state.continueCalled)
-        {
-            m_state.continueCalled = false;
-            continue;
-        }
+        Interpret(forNode->GetIncrement());
     }
 
+    m_loopDepth--;
+
     m_currentSymbolTable = m_currentSymbolTable->GetParentScope();
     m_currentSymbolTable->RemoveScope("ForLoop" + std::to_string(scopeCount));
 
-    m_state.canContinue = retainContinue;
-    m_state.canBreak = retainBreak;
-
     return result;
 }
 
-Value Interpreter::InterpretForEach(TokenNode* node)
+Completion Interpreter::ExecuteForEach(TokenNode* node)
 {
     ForEachNode* forEachNode = dynamic_cast<ForEachNode*>(node);
+    Tracer::Scope trace(m_tracer, Tracer::Category::Loop, "foreach", node->GetLocation());
 
     unsigned int scopeCount = m_currentSymbolTable->GetScopeCount();
     m_currentSymbolTable->AddScope("ForEachLoop" + std::to_string(scopeCount));
     m_currentSymbolTable = m_currentSymbolTable->GetScope("ForEachLoop" + std::to_string(scopeCount));
 
-    Value result(0);
+    Completion result(Completion::Type::Normal, 0);
 
     Value array = Interpret(forEachNode->GetArray());
+    std::string varName(forEachNode->GetToken().GetValue());
 
-    //Value init = Interpret(forNode->GetInit());
-    //Value condition = Interpret(forNode->GetCondition());
-
-    bool retainContinue = m_state.canContinue;
-    bool retainBreak = m_state.canBreak;
-
-    m_state.canContinue = true;
-    m_state.canBreak = true;
+    m_loopDepth++;
 
     if (array.isArray())
     {
-        for (int i = 0; i < array.size(); i++)
+        for (size_t i = 0; i < array.size(); i++)
         {
-            m_currentSymbolTable->RegisterVar(forEachNode->GetToken().GetValue(), array.getArray().at(i));
-            result = Interpret(forEachNode->GetBlock());
-            if (m_state.breakCalled)
+            m_currentSymbolTable->RegisterVar(varName, array[i]);
+            if (ExitsLoop(Execute(forEachNode->GetBlock()), result))
             {
-                m_state.breakCalled = false;
                 break;
             }
-            if (m_state.continueCalled)
-            {
-                m_state.continueCalled = false;
-                continue;
-            }
         }
     }
     else if (array.isString())
     {
-        for (int i = 0; i < array.size(); i++)
+        std::string string = array.getString();
+        for (size_t i = 0; i < string.size(); i++)
         {
-            m_currentSymbolTable->RegisterVar(forEachNode->GetToken().GetValue(), array.getString().substr(i, 1));
-            result = Interpret(forEachNode->GetBlock());
-            if (m_state.breakCalled)
+            m_currentSymbolTable->RegisterVar(varName, std::string(1, string[i]));
+            if (ExitsLoop(Execute(forEachNode->GetBlock()), result))
             {
-                m_state.breakCalled = false;
                 break;
             }
-            if (m_state.continueCalled)
-            {
-                m_state.continueCalled = false;
-                continue;
-            }
         }
     }
 
+    m_loopDepth--;
+
     m_currentSymbolTable = m_currentSymbolTable->GetParentScope();
     m_currentSymbolTable->RemoveScope("ForEachLoop" + std::to_string(scopeCount));
 
-    m_state.canContinue = retainContinue;
-    m_state.canBreak = retainBreak;
-
     return result;
 }
 
@@ -624,25 +650,25 @@ Value Interpreter::InterpretArrayAccess(TokenNode* node)
     ArrayAccessNode* arrayAccessNode = dynamic_cast<ArrayAccessNode*>(node);
 
     Token token = arrayAccessNode->GetToken();
-    std::string varName = token.GetValue();
+    std::string varName(token.GetValue());
 
     Value index = Interpret(arrayAccessNode->GetIndex());
     Value array = Value();
     if (arrayAccessNode->GetObject().GetType() == Token::Type::Identifier)
     {
         Token object = arrayAccessNode->GetObject();
-        if (m_currentSymbolTable->ObjectInstanceExists(object.GetValue(), true))
+        if (m_currentSymbolTable->ObjectInstanceExists(std::string(object.GetValue()), true))
         {
-            std::string instanceName = m_currentSymbolTable->GetObjectInstanceScopeName(object.GetValue());
+            std::string instanceName = m_currentSymbolTable->GetObjectInstanceScopeName(std::string(object.GetValue()));
             array = m_currentSymbolTable->GetScope(instanceName)->GetVar(varName, false);
         }
-        else if (g_symbolTable.ModuleExists(object.GetValue()))
+        else if (g_symbolTable.ModuleExists(std::string(object.GetValue())))
         {
-            array = g_symbolTable.GetModule(object.GetValue())->GetVar(varName, false);
+            array = g_symbolTable.GetModule(std::string(object.GetValue()))->GetVar(varName, false);
         }
         else
         {
-            Error e("Array Access on non-object variable: ", Position("Interpreter", 0, 0, 0));
+            Error e("Array Access on non-object variable: ", node->GetLocation());
             std::cout << e.ToString() << varName << '\n';
             return Value();
         }
@@ -653,13 +679,13 @@ Value Interpreter::InterpretArrayAccess(TokenNode* node)
     }
     if (!array.isString() && !array.isArray())
     {
-        Error e("Array Access on non-array variable: ", Position("Interpreter", 0, 0, 0));
+        Error e("Array Access on non-array variable: ", node->GetLocation());
         std::cout << e.ToString() << varName << '\n';
         return Value();
     }
     if (!index.isNumber())
     {
-        Error e("Array Access with non-integer index: ", Position("Interpreter", 0, 0, 0));
+        Error e("Array Access with non-integer index: ", node->GetLocation());
         std::cout << e.ToString() << varName << '\n';
         return Value();
     }
@@ -669,7 +695,7 @@ Value Interpreter::InterpretArrayAccess(TokenNode* node)
     {
         if (number >= array.getArray().size())
         {
-            Error e("Array Access with out of bounds index: ", Position("Interpreter", 0, 0, 0));
+            Error e("Array Access with out of bounds index: ", node->GetLocation());
             std::cout << e.ToString() << varName << '\n';
             return Value();
         }
@@ -678,7 +704,7 @@ Value Interpreter::InterpretArrayAccess(TokenNode* node)
 
     if (number >= array.getString().size())
     {
-        Error e("Array Access with out of bounds index: ", Position("Interpreter", 0, 0, 0));
+        Error e("Array Access with out of bounds index: ", node->GetLocation());
         std::cout << e.ToString() << varName << '\n';
         return Value();
     }
@@ -701,7 +727,7 @@ Value Interpreter::InterpretArrayInit(TokenNode* node)
     {
         SymbolTable* scope = m_currentSymbolTable;
         Token object = arrayInitNode->GetObject();
-        std::string objectName = object.GetValue();
+        std::string objectName(object.GetValue());
         if (scope->VarExists(objectName))
         {
             Value var = scope->GetVar(objectName, false);
@@ -724,16 +750,16 @@ Value Interpreter::InterpretArrayInit(TokenNode* node)
             }
             else
             {
-                Error e("Unknown Object Instance: ", Position("", 0, 0, 0));
+                Error e("Unknown Object Instance: ", node->GetLocation());
                 std::cout << e.ToString() << object.GetValue() << '\n';
                 return Value();
             }
         }
-        scope->RegisterVar(token.GetValue(), array);
+        scope->RegisterVar(std::string(token.GetValue()), array);
     }
     else
     {
-        m_currentSymbolTable->RegisterVar(token.GetValue(), array);
+        m_currentSymbolTable->RegisterVar(std::string(token.GetValue()), array);
     }
     return array;
 }
@@ -742,26 +768,26 @@ Value Interpreter::InterpretArrayAssign(TokenNode* node)
 {
     ArrayAssignmentNode* arrayAssignNode = dynamic_cast<ArrayAssignmentNode*>(node);
     Token token = arrayAssignNode->GetToken();
-    std::string varName = token.GetValue();
+    std::string varName(token.GetValue());
     Value array = Value();
     SymbolTable* scope = m_currentSymbolTable;
 
     if (arrayAssignNode->GetObject().GetType() == Token::Type::Identifier)
     {
         Token object = arrayAssignNode->GetObject();
-        if (m_currentSymbolTable->ObjectInstanceExists(object.GetValue(), true))
+        if (m_currentSymbolTable->ObjectInstanceExists(std::string(object.GetValue()), true))
         {
-            std::string instanceName = m_currentSymbolTable->GetObjectInstanceScopeName(object.GetValue());
+            std::string instanceName = m_currentSymbolTable->GetObjectInstanceScopeName(std::string(object.GetValue()));
             scope = m_currentSymbolTable->GetScope(instanceName);
             array = scope->GetVar(varName, false);
         }
-        else if (g_symbolTable.ModuleExists(object.GetValue()))
+        else if (g_symbolTable.ModuleExists(std::string(object.GetValue())))
         {
-            array = g_symbolTable.GetModule(object.GetValue())->GetVar(varName, false);
+            array = g_symbolTable.GetModule(std::string(object.GetValue()))->GetVar(varName, false);
         }
         else
         {
-            Error e("Array Assignment on non-object variable: ", Position("Interpreter", 0, 0, 0));
+            Error e("Array Assignment on non-object variable: ", node->GetLocation());
             std::cout << e.ToString() << varName << '\n';
             return Value();
         }
@@ -773,14 +799,14 @@ Value Interpreter::InterpretArrayAssign(TokenNode* node)
 
     if (!array.isArray())
     {
-        Error e("Array Assignment on non-array variable: ", Position("Interpreter", 0, 0, 0));
+        Error e("Array Assignment on non-array variable: ", node->GetLocation());
         std::cout << e.ToString() << varName << '\n';
         return Value();
     }
     Value index = Interpret(arrayAssignNode->GetIndex());
     if (!index.isNumber())
     {
-        Error e("Array Assignment with non-integer index: ", Position("Interpreter", 0, 0, 0));
+        Error e("Array Assignment with non-integer index: ", node->GetLocation());
         std::cout << e.ToString() << varName << '\n';
         return Value();
     }
@@ -804,19 +830,69 @@ Value Interpreter::InterpretFunctionCall(TokenNode* node, SymbolTable* module)
 {
     FunctionCallNode* funcCallNode = dynamic_cast<FunctionCallNode*>(node);
     Token token = funcCallNode->GetToken();
-    std::string funcName = token.GetValue();
+    std::string funcName(token.GetValue());
+
+    bool globalFunctionSearch = true;
+    SymbolTable* scope = ResolveFunctionScope(funcCallNode, module, globalFunctionSearch);
+    if (scope == nullptr)
+    {
+        return Value();
+    }
 
+    if (globalFunctionSearch && m_interpreterFunctions.find(funcName) != m_interpreterFunctions.end())
+    {
+        std::vector<Value> args = InterpretArguments(funcCallNode);
+        return (this->*m_interpreterFunctions.at(funcName))(args, node->GetLocation());
+    }
+    else if (scope->IsBuiltInFunction(funcName, globalFunctionSearch))
+    {
+        std::vector<Value> args = InterpretArguments(funcCallNode);
+        return scope->CallBuiltInFunction(funcName, args, globalFunctionSearch);
+    }
+    else if (scope->IsUserFunction(funcName, globalFunctionSearch))
+    {
+        std::vector<Value> args = InterpretArguments(funcCallNode);
+        TokenNode* body = scope->GetUserFunction(funcName, globalFunctionSearch);
+        // A call that replaces its frame (return f(...);) shows up inside the call it replaced
+        Tracer::Scope trace(m_tracer, Tracer::Category::Function, token.GetValue(), node->GetLocation());
+        if (m_memoizedFunctions.find(body) == m_memoizedFunctions.end())
+        {
+            return CallUserFunction(funcName, scope, body, args, node->GetLocation());
+        }
+
+        // Memoized functions skip the call entirely when the arguments have been seen before
+        Value result;
+        if (m_memoCache.Find(body, args, result))
+        {
+            return result;
+        }
+        result = CallUserFunction(funcName, scope, body, args, node->GetLocation());
+        if (!m_state.hasError)
+        {
+            m_memoCache.Insert(body, args, result);
+        }
+        return result;
+    }
+
+    Error e("Unknown Function: ", node->GetLocation());
+    std::cout << e.ToString() << funcName << '\n';
+    return Value();
+    
+}
+
+SymbolTable* Interpreter::ResolveFunctionScope(FunctionCallNode* funcCallNode, SymbolTable* module, bool& globalFunctionSearch)
+{
     SymbolTable* scope = m_currentSymbolTable;
     if (module != nullptr)
     {
         scope = module;
     }
-    bool globalFunctionSearch = true;
+    globalFunctionSearch = true;
     if (funcCallNode->GetObject().GetType() == Token::Type::Identifier)
     {
         Token object = funcCallNode->GetObject();
-        std::string objectName = object.GetValue();
-        if (scope->VarExists(object.GetValue()))
+        std::string objectName(object.GetValue());
+        if (scope->VarExists(std::string(object.GetValue())))
         {
             Value var = scope->GetVar(objectName, false);
             if (var.isPointer())
@@ -847,137 +923,384 @@ Value Interpreter::InterpretFunctionCall(TokenNode* node, SymbolTable* module)
             }
             else
             {
-                Error e("Function Call on non-object variable: ", Position("Interpreter", 0, 0, 0));
-                std::cout << e.ToString() << funcName << '\n';
-                return Value();
+                Error e("Function Call on non-object variable: ", funcCallNode->GetLocation());
+                std::cout << e.ToString() << funcCallNode->GetToken().GetValue() << '\n';
+                return nullptr;
             }
         }
         globalFunctionSearch = false;
     }
-    if (scope->IsBuiltInFunction(funcName, globalFunctionSearch))
+    return scope;
+}
+
+std::vector<Value> Interpreter::InterpretArguments(FunctionCallNode* funcCallNode)
+{
+    std::vector<Value> args;
+    ArgumentListNode* argListNode = dynamic_cast<ArgumentListNode*>(funcCallNode->GetArguments());
+    if (argListNode)
     {
-        std::vector<Value> args;
-        ArgumentListNode* argListNode = dynamic_cast<ArgumentListNode*>(funcCallNode->GetArguments());
-        if (argListNode)
+        for (TokenNode* argNode : argListNode->GetArguments())
         {
-            for (TokenNode* argNode : argListNode->GetArguments())
-            {
-                args.push_back(Interpret(argNode));
-            }
+            args.push_back(Interpret(argNode));
         }
-        return scope->CallBuiltInFunction(funcName, args, globalFunctionSearch);
     }
-    else if (scope->IsUserFunction(funcName, globalFunctionSearch))
+    return args;
+}
+
+Value Interpreter::CallUserFunction(const std::string& funcName, SymbolTable* parent, TokenNode* body, const std::vector<Value>& args, SourceLocation location)
+{
+    CallFrame newFrame;
+    newFrame.functionName = funcName;
+    newFrame.parentScope = parent;
+    newFrame.body = body;
+    newFrame.args = args;
+
+    char stackMarker;
+    if (m_callStack.IsEmpty())
+    {
+        m_callStack.SetNativeStackBase(&stackMarker);
+    }
+    if (!m_callStack.HasNativeStackRoom(&stackMarker))
+    {
+        Error e("Native stack exhausted at call depth " + std::to_string(m_callStack.GetDepth()) + ": ", location);
+        std::cout << e.ToString() << funcName << '\n';
+        m_state.hasError = true;
+        return Value();
+    }
+    if (!m_callStack.Push(newFrame))
     {
-        std::vector<Value> args;
-        ArgumentListNode* argListNode = dynamic_cast<ArgumentListNode*>(funcCallNode->GetArguments());
-        if (argListNode)
+        Error e("Maximum call depth (" + std::to_string(m_callStack.GetMaxDepth()) + ") exceeded: ", location);
+        std::cout << e.ToString() << funcName << '\n';
+        m_state.hasError = true;
+        return Value();
+    }
+    if (m_profiler != nullptr)
+    {
+        m_profiler->EnterCall(funcName);
+    }
+
+    SymbolTable* current = m_currentSymbolTable;
+    // Loops in the caller can't be broken out of from inside the call
+    unsigned int retainLoopDepth = m_loopDepth;
+    m_loopDepth = 0;
+
+    Value result;
+    while (true)
+    {
+        // Nested calls may grow the stack, so the frame is looked up again after every call
+        CallFrame* frame = &m_callStack.Top();
+        if (frame->scope == nullptr)
+        {
+            unsigned int scopeCount = frame->parentScope->GetScopeCount();
+            frame->scopeName = "UserFunc" + frame->functionName + std::to_string(scopeCount);
+            frame->parentScope->AddScope(frame->scopeName);
+            frame->scope = frame->parentScope->GetScope(frame->scopeName);
+        }
+        frame->scope->RegisterLocalVar("args", frame->args);
+
+        m_currentSymbolTable = frame->scope;
+        Completion completion = Execute(frame->body);
+        m_currentSymbolTable = current;
+
+        result = completion.value;
+
+        frame = &m_callStack.Top();
+        if (!frame->tailCall.pending || completion.type == Completion::Type::Error)
         {
-            for (TokenNode* argNode : argListNode->GetArguments())
+            break;
+        }
+
+        // Tail call: reuse this frame instead of growing the stack. A kept scope only has its args
+        // replaced, so what the caller defined stays visible to the callee.
+        if (!frame->tailCall.keepsScope)
+        {
+            if (frame->tailCall.parentScope == frame->parentScope)
             {
-                args.push_back(Interpret(argNode));
+                frame->scope->CleanUp();
             }
+            else
+            {
+                frame->parentScope->RemoveScope(frame->scopeName);
+                frame->scope = nullptr;
+            }
+        }
+        if (m_profiler != nullptr)
+        {
+            m_profiler->ReplaceCall(frame->tailCall.functionName);
         }
+        frame->functionName = frame->tailCall.functionName;
+        frame->parentScope = frame->tailCall.parentScope;
+        frame->body = frame->tailCall.body;
+        frame->args = frame->tailCall.args;
+        frame->tailCall = TailCall();
+    }
 
-        SymbolTable* parent = scope;
-        SymbolTable* current = m_currentSymbolTable;
-        unsigned int scopeCount = scope->GetScopeCount();
-        scope->AddScope("UserFunc" + funcName + std::to_string(scopeCount));
-        scope = scope->GetScope("UserFunc" + funcName + std::to_string(scopeCount));
-        scope->RegisterVar("args", args);
+    CallFrame& frame = m_callStack.Top();
+    frame.parentScope->RemoveScope(frame.scopeName);
+    if (m_profiler != nullptr)
+    {
+        m_profiler->ExitCall();
+    }
+    m_callStack.Pop();
+
+    m_loopDepth = retainLoopDepth;
+    
+    return result;
+}
 
-        bool retainReturn = m_state.returnCalled;
-        m_state.canReturn = true;
+bool Interpreter::PrepareTailCall(FunctionCallNode* funcCallNode)
+{
+    if (m_callStack.IsEmpty())
+    {
+        return false;
+    }
 
-        m_currentSymbolTable = scope;
-        Value result = Interpret(parent->GetUserFunction(funcName, globalFunctionSearch));
-        m_currentSymbolTable = current;
+    // Lookup is dynamic, so the frame is only replaced when that can't change what the callee sees.
+    // A return inside a block would drop the block's variables, which the callee could still reach.
+    CallFrame& frame = m_callStack.Top();
+    if (m_currentSymbolTable != frame.scope)
+    {
+        return false;
+    }
+    // An unqualified callee runs in the frame's scope, as it would have run beneath it. A method or module
+    // function can't see the caller's variables, but it could be handed an instance made in the caller's scope.
+    bool isQualified = funcCallNode->GetObject().GetType() == Token::Type::Identifier;
+    if (isQualified && frame.scope->GetScopeCount() != 0)
+    {
+        return false;
+    }
 
-        if (m_state.returnCalled)
+    std::string funcName(funcCallNode->GetToken().GetValue());
+    bool globalFunctionSearch = true;
+    SymbolTable* scope = ResolveFunctionScope(funcCallNode, nullptr, globalFunctionSearch);
+    if (scope == nullptr)
+    {
+        // The error has been reported, the call evaluates to null
+        return true;
+    }
+    if (globalFunctionSearch && m_interpreterFunctions.find(funcName) != m_interpreterFunctions.end())
+    {
+        return false;
+    }
+    if (scope->IsBuiltInFunction(funcName, globalFunctionSearch) || !scope->IsUserFunction(funcName, globalFunctionSearch))
+    {
+        return false;
+    }
+
+    TokenNode* body = scope->GetUserFunction(funcName, globalFunctionSearch);
+    if (m_memoizedFunctions.find(body) != m_memoizedFunctions.end())
+    {
+        // Memoized calls go through the cache
+        return false;
+    }
+
+    std::vector<Value> args = InterpretArguments(funcCallNode);
+
+    // Arguments can make calls of their own, so the frame is looked up again
+    CallFrame& caller = m_callStack.Top();
+    caller.tailCall.pending = true;
+    caller.tailCall.functionName = funcName;
+    caller.tailCall.body = body;
+    caller.tailCall.args = args;
+    caller.tailCall.keepsScope = !isQualified;
+    caller.tailCall.parentScope = isQualified ? scope : caller.parentScope;
+    return true;
+}
+
+Value Interpreter::memoize(const std::vector<Value>& args, SourceLocation location)
+{
+    if (args.size() < 1 || args.size() > 2 || !args[0].isString() || (args.size() == 2 && !args[1].isNumber()))
+    {
+        Error e("Memoize expects a function name and an optional capacity", location);
+        std::cout << e.ToString() << '\n';
+        return Value();
+    }
+
+    std::string funcName = args[0].getString();
+    if (!m_currentSymbolTable->IsUserFunction(funcName, true))
+    {
+        Error e("Memoize of unknown function: ", location);
+        std::cout << e.ToString() << funcName << '\n';
+        return Value();
+    }
+
+    if (args.size() == 2)
+    {
+        // Beyond 2^24 a float can't hold every whole number, so larger capacities aren't taken as meant
+        float capacity = args[1].getNumber();
+        if (!(capacity >= 1 && capacity <= MaxMemoCapacity) || capacity != std::floor(capacity))
         {
-            result = m_state.returnValue;
+            Error e("Memoize capacity must be a whole number from 1 to " + std::to_string(MaxMemoCapacity) + ": ", location);
+            std::cout << e.ToString() << args[1].toString() << '\n';
+            return Value();
         }
+        m_memoCache.SetCapacity((size_t)capacity);
+    }
 
-        scope = scope->GetParentScope();
-        scope->RemoveScope("UserFunc" + funcName + std::to_string(scopeCount));
+    m_memoizedFunctions.insert(m_currentSymbolTable->GetUserFunction(funcName, true));
+    return Value();
+}
 
-        m_state.canReturn = retainReturn;
-        
-        return result;
+Value Interpreter::memoStats(const std::vector<Value>& args, SourceLocation location)
+{
+    if (args.size() != 0)
+    {
+        return Value();
     }
 
-    Error e("Unknown Function: ", Position("Interpreter", 0, 0, 0));
-    std::cout << e.ToString() << funcName << '\n';
+    std::vector<Value> stats;
+    stats.push_back(Value((float)m_memoCache.GetHits()));
+    stats.push_back(Value((float)m_memoCache.GetMisses()));
+    stats.push_back(Value((float)m_memoCache.GetSize()));
+    return Value(stats);
+}
+
+Value Interpreter::seed(const std::vector<Value>& args, SourceLocation location)
+{
+    if (args.size() == 1 && args[0].isNumber())
+    {
+        // The number's bits, so a fractional seed gives a different sequence from the whole number below it
+        float number = args[0].getNumber();
+        uint32_t bits;
+        std::memcpy(&bits, &number, sizeof(bits));
+        m_random.Seed(bits);
+    }
+    else if (args.size() == 0)
+    {
+        m_random.SeedFromDevice();
+    }
     return Value();
-    
 }
 
-Value Interpreter::InterpretBreak(TokenNode* node)
+Value Interpreter::random(const std::vector<Value>& args, SourceLocation location)
 {
-    if (!m_state.canBreak)
+    if (args.size() != 2 || !args[0].isNumber() || !args[1].isNumber())
     {
-        Error e("Break called outside of loop: ", Position("Interpreter", 0, 0, 0));
+        Error e("Random expects a minimum and a maximum", location);
         std::cout << e.ToString() << '\n';
+        return Value();
     }
-    else
+
+    return Value(m_random.NextFloat(args[0].getNumber(), args[1].getNumber()));
+}
+
+Value Interpreter::randomArray(const std::vector<Value>& args, SourceLocation location)
+{
+    if (args.size() != 3 || !args[0].isNumber() || !args[1].isNumber() || !args[2].isNumber())
     {
-        m_state.breakCalled = true;
+        Error e("Randomarray expects a count, a minimum and a maximum", location);
+        std::cout << e.ToString() << '\n';
+        return Value();
     }
-    return Value();
+
+    // The array is allocated up front, so the count is bounded rather than left to run out of memory
+    float requested = args[0].getNumber();
+    if (!(requested >= 0 && requested <= MaxRandomArraySize) || requested != std::floor(requested))
+    {
+        Error e("Randomarray count must be a whole number from 0 to " + std::to_string(MaxRandomArraySize) + ": ", location);
+        std::cout << e.ToString() << args[0].toString() << '\n';
+        return Value();
+    }
+
+    size_t count = (size_t)requested;
+    float min = args[1].getNumber();
+    float max = args[2].getNumber();
+    std::vector<Value> values;
+    values.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        values.emplace_back(m_random.NextFloat(min, max));
+    }
+    return Value(std::move(values));
 }
 
-Value Interpreter::InterpretContinue(TokenNode* node)
+void Interpreter::SetMaxCallDepth(unsigned int maxDepth)
 {
-    if (!m_state.canContinue)
+    m_callStack.SetMaxDepth(maxDepth);
+}
+
+const CallStack& Interpreter::GetCallStack() const
+{
+    return m_callStack;
+}
+
+void Interpreter::SetProfiler(Profiler* profiler)
+{
+    m_profiler = profiler;
+}
+
+void Interpreter::SetTracer(Tracer* tracer)
+{
+    m_tracer = tracer;
+}
+
+Completion Interpreter::ExecuteBreak(TokenNode* node)
+{
+    if (m_loopDepth == 0)
     {
-        Error e("Continue called outside of loop: ", Position("Interpreter", 0, 0, 0));
+        Error e("Break called outside of loop: ", node->GetLocation());
         std::cout << e.ToString() << '\n';
+        return Completion();
     }
-    else
+    return Completion(Completion::Type::Break);
+}
+
+Completion Interpreter::ExecuteContinue(TokenNode* node)
+{
+    if (m_loopDepth == 0)
     {
-        m_state.continueCalled = true;
+        Error e("Continue called outside of loop: ", node->GetLocation());
+        std::cout << e.ToString() << '\n';
+        return Completion();
     }
-    return Value();
+    return Completion(Completion::Type::Continue);
 }
 
-Value Interpreter::InterpretReturn(TokenNode* node)
+Completion Interpreter::ExecuteReturn(TokenNode* node)
 {
-    if (!m_state.canReturn)
+    if (m_callStack.IsEmpty())
     {
-        Error e("Return called outside of function: ", Position("Interpreter", 0, 0, 0));
+        Error e("Return called outside of function: ", node->GetLocation());
         std::cout << e.ToString() << '\n';
-        return Value();
+        return Completion();
     }
 
     ReturnNode* returnNode = dynamic_cast<ReturnNode*>(node);
     Value value;
     if (returnNode->GetValue())
     {
+        FunctionCallNode* funcCallNode = dynamic_cast<FunctionCallNode*>(returnNode->GetValue());
+        if (funcCallNode && PrepareTailCall(funcCallNode))
+        {
+            return Completion(Completion::Type::Return);
+        }
         value = Interpret(returnNode->GetValue());
+        if (m_state.hasError)
+        {
+            return Completion(Completion::Type::Error);
+        }
     }
-    m_state.returnCalled = true;
-    m_state.returnValue = value;
-    return value;
+    return Completion(Completion::Type::Return, value);
 }
 
 Value Interpreter::InterpretFunctionDefinition(TokenNode* node)
 {
     FunctionDefinitionNode* funcDefNode = dynamic_cast<FunctionDefinitionNode*>(node);
     Token token = funcDefNode->GetToken();
-    std::string funcName = token.GetValue();
+    std::string funcName(token.GetValue());
 
     SymbolTable* scope = m_currentSymbolTable;
     if (funcDefNode->GetObject().GetType() == Token::Type::Identifier)
     {
         Token object = funcDefNode->GetObject();
-        if (m_currentSymbolTable->ObjectInstanceExists(object.GetValue(), true))
+        if (m_currentSymbolTable->ObjectInstanceExists(std::string(object.GetValue()), true))
         {
-            std::string instanceName = m_currentSymbolTable->GetObjectInstanceScopeName(object.GetValue());
+            std::string instanceName = m_currentSymbolTable->GetObjectInstanceScopeName(std::string(object.GetValue()));
             scope = m_currentSymbolTable->GetScope(instanceName);
         }
         else
         {
-            Error e("Function Definition on non-object variable: ", Position("Interpreter", 0, 0, 0));
+            Error e("Function Definition on non-object variable: ", node->GetLocation());
             std::cout << e.ToString() << funcName << '\n';
             return Value();
         }
@@ -992,17 +1315,15 @@ Value Interpreter::InterpretObjectDefinition(TokenNode* node)
 {
     if (!m_state.canDefineObject)
     {
-        Error e("Object Definition inside of object: ", Position("Interpreter", 0, 0, 0));
+        Error e("Object Definition inside of object: ", node->GetLocation());
         std::cout << e.ToString() << '\n';
         return Value();
     }
 
-    bool retainDefineObject = m_state.canDefineObject;
-    m_state.canDefineObject = false;
-
     ObjectDefinitionNode* objDefNode = dynamic_cast<ObjectDefinitionNode*>(node);
     Token token = objDefNode->GetToken();
-    std::string objName = token.GetValue();
+    Tracer::Scope trace(m_tracer, Tracer::Category::Object, token.GetValue(), node->GetLocation());
+    std::string objName(token.GetValue());
     TokenNode* parentToken = objDefNode->GetParent();
     std::string parentName = "";
     if (parentToken)
@@ -1012,12 +1333,15 @@ Value Interpreter::InterpretObjectDefinition(TokenNode* node)
 
     if (!m_currentSymbolTable->RegisterObject(objName, parentName))
     {
-        Error e("Object Definition with duplicate name: ", Position("Interpreter", 0, 0, 0));
+        Error e("Object Definition with duplicate name: ", node->GetLocation());
         std::cout << e.ToString() << objName << '\n';
         m_state.hasError = true;
         return Value();
     }
 
+    // Both are put back on every return, since a REPL session keeps going after an error
+    bool retainDefineObject = m_state.canDefineObject;
+    m_state.canDefineObject = false;
     std::string objScopeName = m_currentSymbolTable->GetObjectScopeName(objName);
     m_currentSymbolTable = m_currentSymbolTable->GetScope(objScopeName);
 
@@ -1028,9 +1352,11 @@ Value Interpreter::InterpretObjectDefinition(TokenNode* node)
         SequenceNode* seqNode = dynamic_cast<SequenceNode*>(block);
         if (!seqNode)
         {
-            Error e("Object Definition with non-sequence block: ", Position("Interpreter", 0, 0, 0));
+            Error e("Object Definition with non-sequence block: ", node->GetLocation());
             std::cout << e.ToString() << objName << '\n';
             m_state.hasError = true;
+            m_state.canDefineObject = retainDefineObject;
+            m_currentSymbolTable = m_currentSymbolTable->GetParentScope();
             return Value();
         }
 
@@ -1050,9 +1376,11 @@ Value Interpreter::InterpretObjectDefinition(TokenNode* node)
             }
             else
             {
-                Error e("Object Definition with invalid block: ", Position("Interpreter", 0, 0, 0));
+                Error e("Object Definition with invalid block: ", node->GetLocation());
                 std::cout << e.ToString() << objName << '\n';
                 m_state.hasError = true;
+                m_state.canDefineObject = retainDefineObject;
+                m_currentSymbolTable = m_currentSymbolTable->GetParentScope();
                 return Value();
             }
         }
@@ -1068,7 +1396,7 @@ Value Interpreter::InterpretImport(TokenNode* node)
 {
     if (m_currentSymbolTable != &g_symbolTable)
     {
-        Error e("Import called inside of object: ", Position("Interpreter", 0, 0, 0));
+        Error e("Import called inside of object: ", node->GetLocation());
         std::cout << e.ToString() << '\n';
         return Value();
     }
@@ -1077,87 +1405,123 @@ Value Interpreter::InterpretImport(TokenNode* node)
 
     ImportNode* importNode = dynamic_cast<ImportNode*>(node);
     Token token = importNode->GetToken();
+    Tracer::Scope trace(m_tracer, Tracer::Category::Import, token.GetValue(), node->GetLocation());
 
-    std::string modulePath = token.GetValue();
+    std::string modulePath(token.GetValue());
     std::string moduleName = modulePath.substr(modulePath.find_last_of('/') + 1);
     moduleName = moduleName.substr(0, moduleName.find_last_of('.'));
 
     if (m_currentSymbolTable->ModuleExists(moduleName))
     {
-        Error e("Import of already imported module: ", Position("Interpreter", 0, 0, 0));
+        Error e("Import of already imported module: ", node->GetLocation());
         std::cout << e.ToString() << moduleName << '\n';
         return Value();
     }
     
-    std::fstream file;
-    file.open(m_state.currentDirectory + "/" + token.GetValue(), std::ios::in);
-    if (file.is_open())
-    {
-        // Load the file into a string.
-        std::string fileContents;
-        file.seekg(0, std::ios::end);
-        fileContents.resize(file.tellg());
-        file.seekg(0, std::ios::beg);
-        file.read(&fileContents[0], fileContents.size());
-        file.close();
-
-        Lexer lexer(token.GetValue(), fileContents);
-        std::vector<Token> tokens = lexer.generateTokens();
-
-        if (tokens.size() == 0)
-            return Value();
+    std::string fullPath = SourceFile::ResolvePath(m_state.currentDirectory, std::string(token.GetValue()));
+    ModulePreloader::Module module;
+    if (!m_modulePreloader.Take(fullPath, module))
+    {
+        module = ModulePreloader::Load(fullPath, m_moduleCache);
+    }
+    if (!module.exists)
+    {
+        Error e("Import of non-existent module: ", node->GetLocation());
+        std::cout << e.ToString() << token.GetValue() << '\n';
+        return Value();
+    }
+    for (const Error& error : module.errors)
+    {
+        std::cout << error.ToString() << '\n';
+    }
 
-        Parser parser(tokens);
-        TokenNode* node = parser.Parse();
+    TokenNode* moduleNode = module.node;
+    if (!moduleNode)
+        return Value();
 
-        if (!node)
-            return Value();
+    g_symbolTable.RegisterModule(moduleName);
+    m_currentSymbolTable = g_symbolTable.GetModule(moduleName);
 
-        g_symbolTable.RegisterModule(moduleName);
-        m_currentSymbolTable = g_symbolTable.GetModule(moduleName);
+    SetCurrentDirectory(fullPath);
+    Interpret(moduleNode);
 
-        SetCurrentDirectory(m_state.currentDirectory + token.GetValue());
-        Interpret(node);
+    m_currentSymbolTable = &g_symbolTable;
 
-        m_currentSymbolTable = &g_symbolTable;
+    m_state.currentDirectory = dir;
 
-        SetCurrentDirectory(dir);
+    return Value();
+}
 
-        return Value();
-    }
-    else
+void Interpreter::SetCurrentDirectory(const std::string& filePath)
+{
+    m_state.currentDirectory = SourceFile::GetDirectory(filePath);
+}
+
+void Interpreter::PreloadModules(TokenNode* node)
+{
+    m_modulePreloader.Preload(node, m_state.currentDirectory);
+}
+
+bool Interpreter::SaveSnapshot(const std::string& path)
+{
+    Snapshot snapshot;
+    return snapshot.Save(path, g_symbolTable, m_memoCache, m_memoizedFunctions, m_random);
+}
+
+bool Interpreter::RestoreSnapshot(const std::string& path)
+{
+    g_symbolTable.CleanUp();
+    Snapshot snapshot;
+    if (!snapshot.Restore(path, g_symbolTable, m_memoCache, m_memoizedFunctions, m_random))
     {
-        Error e("Import of non-existent module: ", Position("Interpreter", 0, 0, 0));
-        std::cout << e.ToString() << token.GetValue() << '\n';
-        return Value();
+        g_symbolTable.CleanUp();
+        m_memoCache.Clear();
+        m_memoizedFunctions.clear();
+        m_random.Seed(Random::DefaultSeed);
+        return false;
     }
+    return true;
 }
 
-void Interpreter::SetCurrentDirectory(const std::string& filePath)
+ApplicationState& Interpreter::GetState()
+{
+    return m_state;
+}
+
+ModuleCache& Interpreter::GetModuleCache()
+{
+    return m_moduleCache;
+}
+
+ModulePreloader& Interpreter::GetModulePreloader()
+{
+    return m_modulePreloader;
+}
+
+void Interpreter::EndRun()
 {
-    std::string directory = filePath.substr(0, filePath.find_last_of('/'));
-    if (directory.size() > 0)
+    if (m_profiler != nullptr)
     {
-        if (directory[0] == '/')
-        {
-            directory = directory.substr(1);
-        }
+        m_profiler->EndRun();
     }
-    m_state.currentDirectory = directory;
+    m_state.hasError = false;
+    m_state.canDefineObject = true;
+
+    m_callStack.Clear();
+    m_loopDepth = 0;
+
+    m_modulePreloader.Clear();
+    m_currentSymbolTable = &g_symbolTable;
 }
 
 void Interpreter::Reset()
 {
-    m_state.hasError = false;
-    m_state.canBreak = false;
-    m_state.canContinue = false;
-    m_state.canReturn = false;
-    m_state.breakCalled = false;
-    m_state.continueCalled = false;
-    m_state.returnCalled = false;
-    m_state.returnValue = Value();
+    EndRun();
+
+    m_memoCache.Clear();
+    m_memoizedFunctions.clear();
+    m_random.Seed(Random::DefaultSeed);
 
-    m_currentSymbolTable = &g_symbolTable;
     g_symbolTable.CleanUp();
 }
 
@@ -1,8 +1,19 @@
 #pragma once
 
 #include "ApplicationState.hpp"
+#include "CallStack.hpp"
+#include "Completion.hpp"
+#include "MemoCache.hpp"
+#include "ModuleCache.hpp"
+#include "ModulePreloader.hpp"
+#include "Profiler.hpp"
+#include "Random.hpp"
+#include "Tracer.hpp"
 #include "TokenNode.hpp"
 
+#include <unordered_map>
+#include <unordered_set>
+
 class SymbolTable;
 class Value;
 
@@ -18,7 +29,18 @@ public:
     ApplicationState& GetState();
 
     Value Interpret(TokenNode* node);
-    Value InterpretSequence(TokenNode* node);
+    Completion Execute(TokenNode* node);
+
+    Completion ExecuteSequence(TokenNode* node);
+    Completion ExecuteIf(TokenNode* node);
+    Completion ExecuteWhile(TokenNode* node);
+    Completion ExecuteFor(TokenNode* node);
+    Completion ExecuteForEach(TokenNode* node);
+    Completion ExecuteBreak(TokenNode* node);
+    Completion ExecuteContinue(TokenNode* node);
+    Completion ExecuteReturn(TokenNode* node);
+    Completion ExecuteLazyBlock(TokenNode* node);
+
     Value InterpretNumber(TokenNode* node);
     Value InterpretString(TokenNode* node);
     Value InterpretArray(TokenNode* node);
@@ -26,27 +48,72 @@ public:
     Value InterpretUnaryOperation(TokenNode* node);
     Value InterpretVarAssign(TokenNode* node);
     Value InterpretIdentifier(TokenNode* node);
-    Value InterpretIf(TokenNode* node);
-    Value InterpretWhile(TokenNode* node);
-    Value InterpretFor(TokenNode* node);
-    Value InterpretForEach(TokenNode* node);
     Value InterpretArrayAccess(TokenNode* node);
     Value InterpretArrayInit(TokenNode* node);
     Value InterpretArrayAssign(TokenNode* node);
     Value InterpretFunctionCall(TokenNode* node, SymbolTable* module = nullptr);
-    Value InterpretBreak(TokenNode* node);
-    Value InterpretContinue(TokenNode* node);
-    Value InterpretReturn(TokenNode* node);
     Value InterpretFunctionDefinition(TokenNode* node);
     Value InterpretObjectDefinition(TokenNode* node);
     Value InterpretImport(TokenNode* node);
 
     void SetCurrentDirectory(const std::string& directory);
 
+    // Loads everything the script imports ahead of running it. Call after SetCurrentDirectory.
+    void PreloadModules(TokenNode* node);
+
+    // Saves or restores the global state left behind by a script, see Snapshot
+    bool SaveSnapshot(const std::string& path);
+    bool RestoreSnapshot(const std::string& path);
+
+    ModuleCache& GetModuleCache();
+    ModulePreloader& GetModulePreloader();
+
+    void SetMaxCallDepth(unsigned int maxDepth);
+    const CallStack& GetCallStack() const;
+
+    // Samples are taken while a profiler is set, see Profiler. nullptr turns profiling off.
+    void SetProfiler(Profiler* profiler);
+    // Events are recorded while a tracer is set, see Tracer. nullptr turns tracing off.
+    void SetTracer(Tracer* tracer);
+
+    // Clears what a run leaves behind, such as an error or a call stack cut short by one,
+    // but keeps the variables, functions, objects and modules it defined
+    void EndRun();
+    // EndRun, and forgets everything the run defined
     void Reset();
 private:
     SymbolTable* m_currentSymbolTable;
     ApplicationState m_state;
+    CallStack m_callStack;
+    unsigned int m_loopDepth;
+    Profiler* m_profiler;
+    Tracer* m_tracer;
+
+    ModuleCache m_moduleCache;
+    ModulePreloader m_modulePreloader;
+
+    MemoCache m_memoCache;
+    std::unordered_set<const TokenNode*> m_memoizedFunctions;
+    // Behind seed, random and randomarray. Reset starts it again from the default seed.
+    Random m_random;
+
+    // Built-in functions that need the interpreter's state. They're given the call's location to report errors at.
+    typedef Value(Interpreter::*InterpreterFunction)(const std::vector<Value>&, SourceLocation);
+    std::unordered_map<std::string, InterpreterFunction> m_interpreterFunctions;
+
+    Value memoize(const std::vector<Value>& args, SourceLocation location);
+    Value memoStats(const std::vector<Value>& args, SourceLocation location);
+    Value seed(const std::vector<Value>& args, SourceLocation location);
+    Value random(const std::vector<Value>& args, SourceLocation location);
+    Value randomArray(const std::vector<Value>& args, SourceLocation location);
+
+    bool IsStatement(TokenNode* node) const;
+    bool ExitsLoop(const Completion& body, Completion& result) const;
+
+    SymbolTable* ResolveFunctionScope(FunctionCallNode* funcCallNode, SymbolTable* module, bool& globalFunctionSearch);
+    std::vector<Value> InterpretArguments(FunctionCallNode* funcCallNode);
+    Value CallUserFunction(const std::string& funcName, SymbolTable* parent, TokenNode* body, const std::vector<Value>& args, SourceLocation location);
+    bool PrepareTailCall(FunctionCallNode* funcCallNode);
 
     std::vector<std::string> SplitString(const std::string& string);
 };
\ No newline at end of file
@@ -1,14 +1,146 @@
 #include "Lexer.hpp"
 
-#include <algorithm>
-#include <iostream>
+#include <array>
 
 #include "Error.hpp"
-#include "SymbolTable.hpp"
+#include "SourceFile.hpp"
 #include "Token.hpp"
 
-Lexer::Lexer(const std::string& fileName, const std::string& source)
-    : m_source(source), m_position(fileName, 1, 0, 0), m_currentChar(m_source[m_position.GetIndex()])
+enum CharClass : unsigned char
+{
+    Space = 1 << 0,
+    Digit = 1 << 1,
+    Letter = 1 << 2,
+    Underscore = 1 << 3,
+    Dot = 1 << 4
+};
+
+static constexpr std::array<unsigned char, 256> MakeCharClasses()
+{
+    std::array<unsigned char, 256> classes {};
+    classes[' '] = classes['\t'] = classes['\n'] = classes['\r'] = Space;
+    for (int c = '0'; c <= '9'; c++)
+    {
+        classes[c] = Digit;
+    }
+    for (int c = 'a'; c <= 'z'; c++)
+    {
+        classes[c] = Letter;
+        classes[c - 'a' + 'A'] = Letter;
+    }
+    classes['_'] = Underscore;
+    classes['.'] = Dot;
+    return classes;
+}
+
+// Characters that are always a token on their own
+static constexpr std::array<Token::Type, 256> MakeSingleCharTokens()
+{
+    std::array<Token::Type, 256> types {};
+    types['*'] = Token::Type::Multiply;
+    types['^'] = Token::Type::Power;
+    types['('] = Token::Type::LeftParenthesis;
+    types[')'] = Token::Type::RightParenthesis;
+    types['{'] = Token::Type::LeftBrace;
+    types['}'] = Token::Type::RightBrace;
+    types['['] = Token::Type::LeftBracket;
+    types[']'] = Token::Type::RightBracket;
+    types[';'] = Token::Type::Semicolon;
+    types[','] = Token::Type::Comma;
+    types['.'] = Token::Type::Dot;
+    return types;
+}
+
+static constexpr std::array<unsigned char, 256> s_charClasses = MakeCharClasses();
+static constexpr std::array<Token::Type, 256> s_singleCharTokens = MakeSingleCharTokens();
+
+static unsigned char GetCharClass(char c)
+{
+    return s_charClasses[(unsigned char)c];
+}
+
+static bool IsKeyword(std::string_view word)
+{
+    switch (word.length())
+    {
+    case 2:
+        return word == "if" || word == "do" || word == "in";
+    case 3:
+        return word == "for";
+    case 4:
+        return word == "else" || word == "true" || word == "null" || word == "func" || word == "this";
+    case 5:
+        return word == "while" || word == "false" || word == "break";
+    case 6:
+        return word == "return" || word == "object" || word == "import";
+    case 7:
+        return word == "foreach";
+    case 8:
+        return word == "continue";
+    default:
+        return false;
+    }
+}
+
+// Operators other than the single character ones. Returns None if there is no match.
+static Token::Type MatchOperator(char currentChar, char nextChar, size_t& length)
+{
+    length = 2;
+    switch (currentChar)
+    {
+    case '+':
+        if (nextChar == '+')
+        {
+            return Token::Type::Increment;
+        }
+        if (nextChar == '=')
+        {
+            return Token::Type::PlusEqual;
+        }
+        length = 1;
+        return Token::Type::Plus;
+    case '-':
+        if (nextChar == '-')
+        {
+            return Token::Type::Decrement;
+        }
+        if (nextChar == '=')
+        {
+            return Token::Type::MinusEqual;
+        }
+        length = 1;
+        return Token::Type::Minus;
+    case '=':
+        length = nextChar == '=' ? 2 : 1;
+        return nextChar == '=' ? Token::Type::IsEqual : Token::Type::Equals;
+    case '!':
+        length = nextChar == '=' ? 2 : 1;
+        return nextChar == '=' ? Token::Type::IsNotEqual : Token::Type::LogicalNot;
+    case '>':
+        length = nextChar == '=' ? 2 : 1;
+        return nextChar == '=' ? Token::Type::GreaterThanOrEqual : Token::Type::GreaterThan;
+    case '<':
+        length = nextChar == '=' ? 2 : 1;
+        return nextChar == '=' ? Token::Type::LessThanOrEqual : Token::Type::LessThan;
+    case '&':
+        return nextChar == '&' ? Token::Type::ConditionalAnd : Token::Type::None;
+    case '|':
+        return nextChar == '|' ? Token::Type::ConditionalOr : Token::Type::None;
+    case '/':
+        length = 1;
+        return Token::Type::Divide;
+    default:
+        return Token::Type::None;
+    }
+}
+
+Lexer::Lexer(const SourceFile* source)
+    : m_sourceFile(source), m_source(source->GetText()), m_baseLocation(source->GetBaseLocation()), m_index(0)
+{
+}
+
+Lexer::Lexer(const SourceFile* source, size_t start, size_t end)
+    : m_sourceFile(source), m_source(source->GetText().substr(0, end)), m_baseLocation(source->GetBaseLocation()), m_index(start)
 {
 }
 
@@ -16,316 +148,173 @@ Lexer::~Lexer()
 {
 }
 
-void Lexer::advance()
+char Lexer::peek(size_t offset) const
 {
-    m_position.advance(m_currentChar);
-    if (m_position.GetIndex() > m_source.length() - 1)
+    if (m_index + offset >= m_source.length())
     {
-        m_currentChar = '\0';
+        return '\0';
     }
-    else
+    return m_source[m_index + offset];
+}
+
+void Lexer::reportError(const std::string& message, size_t index)
+{
+    m_errors.push_back(Error(message, getLocation(index)));
+}
+
+SourceLocation Lexer::getLocation(size_t index) const
+{
+    if (m_baseLocation == NoLocation)
     {
-        m_currentChar = m_source[m_position.GetIndex()];
+        return NoLocation;
     }
+    return m_baseLocation + index;
 }
 
-std::vector<Token> Lexer::generateTokens()
+Token Lexer::NextToken()
 {
-    std::vector<Token> tokens;
-    while (m_currentChar != '\0')
+    while (m_index < m_source.length())
     {
-        if (m_currentChar == ' ' || m_currentChar == '\t' || m_currentChar == '\n' || m_currentChar == '\r')
+        char currentChar = m_source[m_index];
+        unsigned char charClass = GetCharClass(currentChar);
+        size_t start = m_index;
+
+        if (charClass & Space)
         {
-            advance();
+            m_index++;
         }
-        else if (isdigit(m_currentChar))
+        else if (charClass & Digit)
         {
             unsigned int dotCount = 0;
-            std::string numberString = "";
-            while (isdigit(m_currentChar) || m_currentChar == '.')
+            while (GetCharClass(peek()) & (Digit | Dot))
             {
-                if (m_currentChar == '.')
+                if (peek() == '.')
                 {
                     dotCount++;
                 }
-                numberString += m_currentChar;
-                advance();
+                m_index++;
             }
+            std::string_view number = m_source.substr(start, m_index - start);
             if (dotCount > 1)
             {
-                Error error("Invalid number format: " + numberString, m_position);
-                std::cout << error.ToString() << '\n';
-                return std::vector<Token>();
-            }
-            tokens.push_back(Token(Token::Type::Number, numberString));
-        }
-        else if (m_currentChar == '"')
-        {
-            std::string string = "";
-            advance();
-            while (m_currentChar != '"')
-            {
-                if (m_currentChar == '\0')
-                {
-                    Error error("Unterminated string", m_position);
-                    std::cout << error.ToString() << '\n';
-                    return std::vector<Token>();
-                }
-                string += m_currentChar;
-                advance();
+                // Still a number as far as the parser is concerned
+                reportError("Invalid number format: " + std::string(number), m_index);
             }
-            advance();
-            tokens.push_back(Token(Token::Type::String, string));
+            return Token(Token::Type::Number, number, getLocation(start));
         }
-        else if (isalpha(m_currentChar))
+        else if (charClass & Letter)
         {
-            // Identifier
-            std::string identifier = "";
-            while (isalnum(m_currentChar) || m_currentChar == '_')
+            while (GetCharClass(peek()) & (Letter | Digit | Underscore))
             {
-                identifier += m_currentChar;
-                advance();
+                m_index++;
             }
+            std::string_view identifier = m_source.substr(start, m_index - start);
 
-            if (g_symbolTable.IsKeyword(identifier))
-            {
-                if (identifier == "true")
-                {
-                    tokens.push_back(Token(Token::Type::Number, std::to_string(1)));
-                }
-                else if (identifier == "false")
-                {
-                    tokens.push_back(Token(Token::Type::Number, std::to_string(0)));
-                }
-                else if (identifier == "null")
-                {
-                    tokens.push_back(Token(Token::Type::Number, ""));
-                }
-                else
-                {
-                    tokens.push_back(Token(Token::Type::Keyword, identifier));
-                }
-            }
-            else
-            {
-                tokens.push_back(Token(Token::Type::Identifier, identifier));
-            }
-        }
-        else if (m_currentChar == '+')
-        {
-            advance();
-            if (m_currentChar == '+')
-            {
-                advance();
-                tokens.push_back(Token(Token::Type::Increment, "++"));
-            }
-            else if (m_currentChar == '=')
-            {
-                advance();
-                tokens.push_back(Token(Token::Type::PlusEqual, "+="));
-            }
-            else
+            if (!IsKeyword(identifier))
             {
-                tokens.push_back(Token(Token::Type::Plus, "+"));
+                return Token(Token::Type::Identifier, identifier, getLocation(start));
             }
-        }
-        else if (m_currentChar == '-')
-        {
-            advance();
-            if (m_currentChar == '-')
+            else if (identifier == "true")
             {
-                advance();
-                tokens.push_back(Token(Token::Type::Decrement, "--"));
+                return Token(Token::Type::Number, "1", getLocation(start));
             }
-            else if (m_currentChar == '=')
+            else if (identifier == "false")
             {
-                advance();
-                tokens.push_back(Token(Token::Type::MinusEqual, "-="));
+                return Token(Token::Type::Number, "0", getLocation(start));
             }
-            else
+            else if (identifier == "null")
             {
-                tokens.push_back(Token(Token::Type::Minus, "-"));
+                return Token(Token::Type::Number, "", getLocation(start));
             }
+            return Token(Token::Type::Keyword, identifier, getLocation(start));
         }
-        else if (m_currentChar == '*')
+        else if (s_singleCharTokens[(unsigned char)currentChar] != Token::Type::None)
         {
-            tokens.push_back(Token(Token::Type::Multiply, "*"));
-            advance();
+            m_index++;
+            return Token(s_singleCharTokens[(unsigned char)currentChar], m_source.substr(start, 1), getLocation(start));
         }
-        else if (m_currentChar == '/')
+        else if (currentChar == '"')
         {
-            advance();
-            if (m_currentChar == '/')
-            {
-                // Comment
-                while (m_currentChar != '\n' && m_currentChar != '\0')
-                {
-                    advance();
-                }
-            }
-            else if (m_currentChar == '*')
+            size_t end = m_source.find('"', start + 1);
+            if (end == std::string_view::npos)
             {
-                // Comment
-                advance();
-                while (m_currentChar != '\0')
-                {
-                    if (m_currentChar == '*' && m_source[m_position.GetIndex() + 1] == '/')
-                    {
-                        advance();
-                        advance();
-                        break;
-                    }
-                    advance();
-                }
-            }
-            else
-            {
-                tokens.push_back(Token(Token::Type::Divide, "/"));
-            }
-        }
-        else if (m_currentChar == '^')
-        {
-            tokens.push_back(Token(Token::Type::Power, "^"));
-            advance();
-        }
-        else if (m_currentChar == '(')
-        {
-            tokens.push_back(Token(Token::Type::LeftParenthesis, "("));
-            advance();
-        }
-        else if (m_currentChar == ')')
-        {
-            tokens.push_back(Token(Token::Type::RightParenthesis, ")"));
-            advance();
-        }
-        else if (m_currentChar == '{')
-        {
-            tokens.push_back(Token(Token::Type::LeftBrace, "{"));
-            advance();
-        }
-        else if (m_currentChar == '}')
-        {
-            tokens.push_back(Token(Token::Type::RightBrace, "}"));
-            advance();
-        }
-        else if (m_currentChar == '[')
-        {
-            tokens.push_back(Token(Token::Type::LeftBracket, "["));
-            advance();
-        }
-        else if (m_currentChar == ']')
-        {
-            tokens.push_back(Token(Token::Type::RightBracket, "]"));
-            advance();
-        }
-        else if (m_currentChar == ';')
-        {
-            tokens.push_back(Token(Token::Type::Semicolon, ";"));
-            advance();
-        }
-        else if (m_currentChar == '=')
-        {
-            advance();
-            if (m_currentChar == '=')
-            {
-                advance();
-                tokens.push_back(Token(Token::Type::IsEqual, "=="));
-            }
-            else
-            {
-                tokens.push_back(Token(Token::Type::Equals, "="));
-            }
-        }
-        else if (m_currentChar == '!')
-        {
-            advance();
-            if (m_currentChar == '=')
-            {
-                advance();
-                tokens.push_back(Token(Token::Type::IsNotEqual, "!="));
-            }
-            else
-            {
-                tokens.push_back(Token(Token::Type::LogicalNot, "!"));
+                reportError("Unterminated string", m_source.length());
+                m_index = m_source.length();
+                break;
             }
+            m_index = end + 1;
+            return Token(Token::Type::String, m_source.substr(start + 1, end - start - 1), getLocation(start));
         }
-        else if (m_currentChar == '&')
+        else if (currentChar == '/' && peek(1) == '/')
         {
-            advance();
-            if (m_currentChar == '&')
-            {
-                advance();
-                tokens.push_back(Token(Token::Type::ConditionalAnd, "&&"));
-            }
-            else
-            {
-                Error error("Unexpected character '" + std::string(1, m_currentChar) + "'", m_position);
-                std::cout << error.ToString() << "'\n";
-                return std::vector<Token>();
-            }
+            // Comment
+            size_t end = m_source.find('\n', start);
+            m_index = end == std::string_view::npos ? m_source.length() : end;
         }
-        else if (m_currentChar == '|')
+        else if (currentChar == '/' && peek(1) == '*')
         {
-            advance();
-            if (m_currentChar == '|')
-            {
-                advance();
-                tokens.push_back(Token(Token::Type::ConditionalOr, "||"));
-            }
-            else
-            {
-                Error error("Unexpected character '" + std::string(1, m_currentChar) + "'", m_position);
-                std::cout << error.ToString() << "'\n";
-                return std::vector<Token>();
-            }
+            // Comment
+            size_t end = m_source.find("*/", start + 2);
+            m_index = end == std::string_view::npos ? m_source.length() : end + 2;
         }
-        else if (m_currentChar == '>')
+        else
         {
-            advance();
-            if (m_currentChar == '=')
-            {
-                advance();
-                tokens.push_back(Token(Token::Type::GreaterThanOrEqual, ">="));
-            }
-            else
+            size_t length;
+            Token::Type type = MatchOperator(currentChar, peek(1), length);
+            if (type != Token::Type::None)
             {
-                tokens.push_back(Token(Token::Type::GreaterThan, ">"));
+                m_index += length;
+                return Token(type, m_source.substr(start, length), getLocation(start));
             }
-        }
-        else if (m_currentChar == '<')
-        {
-            advance();
-            if (m_currentChar == '=')
+            else if (currentChar == '\0')
             {
-                advance();
-                tokens.push_back(Token(Token::Type::LessThanOrEqual, "<="));
+                // The source ends at the first null character
+                m_index = m_source.length();
             }
             else
             {
-                tokens.push_back(Token(Token::Type::LessThan, "<"));
+                // Skip it and carry on, so the rest of the source is still checked. A lone & or | lands here too.
+                reportError("Unexpected character '" + std::string(1, currentChar) + "'", start);
+                m_index++;
             }
         }
-        else if (m_currentChar == ',')
-        {
-            tokens.push_back(Token(Token::Type::Comma, ","));
-            advance();
-        }
-        else if (m_currentChar == '.')
-        {
-            tokens.push_back(Token(Token::Type::Dot, "."));
-            advance();
-        }
-        else if (m_currentChar == '\0')
-        {
-            break;
-        }
-        else
-        {
-            Error error("Unexpected character '" + std::string(1, m_currentChar) + "'", m_position);
-            std::cout << error.ToString() << "'\n";
-            return std::vector<Token>();
-        }
     }
-    tokens.push_back(Token(Token::Type::EndOfFile, ""));
+    return Token(Token::Type::EndOfFile, "", getLocation(m_index));
+}
+
+std::vector<Token> Lexer::generateTokens()
+{
+    std::vector<Token> tokens;
+    tokens.reserve(m_source.length() / 4 + 1);
+
+    do
+    {
+        tokens.push_back(NextToken());
+    } while (tokens.back().GetType() != Token::Type::EndOfFile);
+
+    if (HasError())
+    {
+        return std::vector<Token>();
+    }
     return tokens;
+}
+
+bool Lexer::HasError() const
+{
+    return !m_errors.empty();
+}
+
+const std::vector<Error>& Lexer::GetErrors() const
+{
+    return m_errors;
+}
+
+const SourceFile* Lexer::GetSource() const
+{
+    return m_sourceFile;
+}
+
+SourceLocation Lexer::GetBaseLocation() const
+{
+    return m_baseLocation;
 }
\ No newline at end of file
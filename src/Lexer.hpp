@@ -1,22 +1,40 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 
-#include "Position.hpp"
+#include "Error.hpp"
+#include "SourceMap.hpp"
+#include "Token.hpp"
 
-class Token;
+class SourceFile;
 class Lexer
 {
 public:
-    Lexer(const std::string& fileName, const std::string& source);
+    // The source isn't copied, and token values view into it
+    Lexer(const SourceFile* source);
+    // Lexes the characters from start up to end, keeping their locations in the whole source
+    Lexer(const SourceFile* source, size_t start, size_t end);
     ~Lexer();
 
+    // Returns EndOfFile at the end of the source. Errors are recorded and the bad characters skipped.
+    Token NextToken();
+    // Lexes the whole source, returning no tokens if there is an error
     std::vector<Token> generateTokens();
+    bool HasError() const;
+    const std::vector<Error>& GetErrors() const;
+
+    const SourceFile* GetSource() const;
+    SourceLocation GetBaseLocation() const;
 private:
-    std::string m_source;
-    Position m_position;
-    char m_currentChar;
-    
-    void advance();
+    const SourceFile* m_sourceFile;
+    std::string_view m_source;
+    SourceLocation m_baseLocation;
+    size_t m_index;
+    std::vector<Error> m_errors;
+
+    void reportError(const std::string& message, size_t index);
+    SourceLocation getLocation(size_t index) const;
+    char peek(size_t offset = 0) const;
 };
\ No newline at end of file
@@ -0,0 +1,235 @@
+#include "MemoCache.hpp"
+
+#include <functional>
+#include <iterator>
+#include <string>
+
+#include "AstSerializer.hpp"
+#include "Snapshot.hpp"
+
+MemoCache::MemoCache(size_t capacity)
+    : m_capacity(capacity), m_hits(0), m_misses(0)
+{
+}
+
+MemoCache::~MemoCache()
+{
+}
+
+bool MemoCache::Find(const TokenNode* function, const std::vector<Value>& args, Value& result)
+{
+    size_t hash = Hash(function, args);
+    auto range = m_index.equal_range(hash);
+    for (auto it = range.first; it != range.second; it++)
+    {
+        Entry& entry = *it->second;
+        if (entry.function != function || entry.args.size() != args.size())
+        {
+            continue;
+        }
+
+        bool match = true;
+        for (size_t i = 0; i < args.size() && match; i++)
+        {
+            match = Identical(entry.args[i], args[i]);
+        }
+
+        if (match)
+        {
+            m_entries.splice(m_entries.begin(), m_entries, it->second);
+            result = entry.result;
+            m_hits++;
+            return true;
+        }
+    }
+
+    m_misses++;
+    return false;
+}
+
+void MemoCache::Insert(const TokenNode* function, const std::vector<Value>& args, const Value& result)
+{
+    if (m_capacity == 0)
+    {
+        return;
+    }
+
+    size_t hash = Hash(function, args);
+    m_entries.push_front({ function, args, result, hash });
+    m_index.emplace(hash, m_entries.begin());
+
+    while (m_entries.size() > m_capacity)
+    {
+        Evict();
+    }
+}
+
+void MemoCache::SetCapacity(size_t capacity)
+{
+    m_capacity = capacity;
+    while (m_entries.size() > m_capacity)
+    {
+        Evict();
+    }
+}
+
+size_t MemoCache::GetCapacity() const
+{
+    return m_capacity;
+}
+
+size_t MemoCache::GetSize() const
+{
+    return m_entries.size();
+}
+
+unsigned long long MemoCache::GetHits() const
+{
+    return m_hits;
+}
+
+unsigned long long MemoCache::GetMisses() const
+{
+    return m_misses;
+}
+
+void MemoCache::Clear()
+{
+    m_entries.clear();
+    m_index.clear();
+    m_hits = 0;
+    m_misses = 0;
+}
+
+void MemoCache::Write(AstWriter& writer, const BodyTable& bodies) const
+{
+    writer.WriteUInt64(m_capacity);
+    writer.WriteUInt64(m_hits);
+    writer.WriteUInt64(m_misses);
+
+    std::vector<std::pair<unsigned int, const Entry*>> entries;
+    for (const Entry& entry : m_entries)
+    {
+        unsigned int index;
+        if (bodies.Find(entry.function, index))
+        {
+            entries.emplace_back(index, &entry);
+        }
+    }
+
+    // Least recently used first, so inserting them in order gives back the same order
+    writer.WriteUInt32(entries.size());
+    for (auto it = entries.rbegin(); it != entries.rend(); it++)
+    {
+        writer.WriteUInt32(it->first);
+        writer.WriteUInt32(it->second->args.size());
+        for (const Value& arg : it->second->args)
+        {
+            writer.WriteValue(arg);
+        }
+        writer.WriteValue(it->second->result);
+    }
+}
+
+bool MemoCache::Read(AstReader& reader, const BodyTable& bodies)
+{
+    Clear();
+    m_capacity = reader.ReadUInt64();
+    unsigned long long hits = reader.ReadUInt64();
+    unsigned long long misses = reader.ReadUInt64();
+
+    unsigned int count = reader.ReadUInt32();
+    for (unsigned int i = 0; i < count && !reader.HasError(); i++)
+    {
+        const TokenNode* function = bodies.Get(reader.ReadUInt32());
+        if (function == NULL)
+        {
+            return false;
+        }
+        std::vector<Value> args;
+        unsigned int argCount = reader.ReadUInt32();
+        for (unsigned int arg = 0; arg < argCount && !reader.HasError(); arg++)
+        {
+            args.push_back(reader.ReadValue());
+        }
+        Value result = reader.ReadValue();
+        Insert(function, args, result);
+    }
+
+    m_hits = hits;
+    m_misses = misses;
+    return !reader.HasError();
+}
+
+size_t MemoCache::Hash(const TokenNode* function, const std::vector<Value>& args)
+{
+    size_t hash = std::hash<const TokenNode*>()(function);
+    for (const Value& arg : args)
+    {
+        hash ^= HashValue(arg) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    }
+    return hash;
+}
+
+size_t MemoCache::HashValue(const Value& value)
+{
+    if (value.isNumber())
+    {
+        // 0 and -0 compare equal, so they have to hash the same
+        float number = value.getNumber();
+        return number == 0 ? 0 : std::hash<float>()(number);
+    }
+    else if (value.isString() || value.isPointer())
+    {
+        return std::hash<std::string>()(value.getString()) + value.isPointer();
+    }
+    else if (value.isArray())
+    {
+        size_t hash = value.size();
+        for (size_t i = 0; i < value.size(); i++)
+        {
+            hash ^= HashValue(value[i]) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+        }
+        return hash;
+    }
+    return 0;
+}
+
+bool MemoCache::Identical(const Value& a, const Value& b)
+{
+    if (a.isArray() && b.isArray())
+    {
+        if (a.size() != b.size())
+        {
+            return false;
+        }
+        for (size_t i = 0; i < a.size(); i++)
+        {
+            if (!Identical(a[i], b[i]))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+    if (a.isNull() && b.isNull())
+    {
+        return true;
+    }
+    return a == b;
+}
+
+void MemoCache::Evict()
+{
+    std::list<Entry>::iterator last = std::prev(m_entries.end());
+    auto range = m_index.equal_range(last->hash);
+    for (auto it = range.first; it != range.second; it++)
+    {
+        if (it->second == last)
+        {
+            m_index.erase(it);
+            break;
+        }
+    }
+    m_entries.pop_back();
+}
\ No newline at end of file
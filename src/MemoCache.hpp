@@ -0,0 +1,63 @@
+#pragma once
+
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "Value.hpp"
+
+class AstReader;
+class AstWriter;
+class BodyTable;
+class TokenNode;
+
+// Bounded LRU table of user function results, keyed on the function body and its arguments
+class MemoCache
+{
+public:
+    static const size_t DefaultCapacity = 4096;
+
+    MemoCache(size_t capacity = DefaultCapacity);
+    ~MemoCache();
+
+    bool Find(const TokenNode* function, const std::vector<Value>& args, Value& result);
+    void Insert(const TokenNode* function, const std::vector<Value>& args, const Value& result);
+
+    void SetCapacity(size_t capacity);
+    size_t GetCapacity() const;
+    size_t GetSize() const;
+
+    unsigned long long GetHits() const;
+    unsigned long long GetMisses() const;
+
+    void Clear();
+
+    // Records the entries and counts for a snapshot. Entries for bodies that aren't in bodies are left out,
+    // since nothing restored from it can call them.
+    void Write(AstWriter& writer, const BodyTable& bodies) const;
+    // Replaces the contents with what Write recorded. Returns false if it's malformed.
+    bool Read(AstReader& reader, const BodyTable& bodies);
+
+private:
+    struct Entry
+    {
+        const TokenNode* function;
+        std::vector<Value> args;
+        Value result;
+        size_t hash;
+    };
+
+    // Most recently used first
+    std::list<Entry> m_entries;
+    std::unordered_multimap<size_t, std::list<Entry>::iterator> m_index;
+    size_t m_capacity;
+
+    unsigned long long m_hits;
+    unsigned long long m_misses;
+
+    static size_t Hash(const TokenNode* function, const std::vector<Value>& args);
+    static size_t HashValue(const Value& value);
+    static bool Identical(const Value& a, const Value& b);
+
+    void Evict();
+};
\ No newline at end of file
@@ -0,0 +1,88 @@
+#include "MemoryTracker.hpp"
+
+#include <atomic>
+#include <iomanip>
+
+static const unsigned int CategoryCount = (unsigned int)MemoryTracker::Category::Count;
+
+// Keeps the object after the header as aligned as operator new would have
+static const size_t HeaderSize = alignof(std::max_align_t);
+
+static const char* const s_categoryNames[CategoryCount] = { "AST", "Value string", "Value array", "SymbolTable", "Token" };
+
+// Modules are parsed on several threads
+static std::atomic<long long> s_liveBytes[CategoryCount];
+static std::atomic<long long> s_peakBytes[CategoryCount];
+static std::atomic<unsigned long long> s_allocations[CategoryCount];
+
+void MemoryTracker::Enable()
+{
+    s_isEnabled = true;
+}
+
+void MemoryTracker::Allocate(Category category, size_t bytes)
+{
+    unsigned int index = (unsigned int)category;
+    long long live = s_liveBytes[index].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    s_allocations[index].fetch_add(1, std::memory_order_relaxed);
+
+    long long peak = s_peakBytes[index].load(std::memory_order_relaxed);
+    while (live > peak && !s_peakBytes[index].compare_exchange_weak(peak, live, std::memory_order_relaxed))
+    {
+    }
+}
+
+void MemoryTracker::Free(Category category, size_t bytes)
+{
+    s_liveBytes[(unsigned int)category].fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+void* MemoryTracker::AllocateObject(Category category, size_t bytes)
+{
+    if (!s_isEnabled)
+    {
+        return ::operator new(bytes);
+    }
+
+    char* block = static_cast<char*>(::operator new(bytes + HeaderSize));
+    *reinterpret_cast<size_t*>(block) = bytes;
+    Allocate(category, bytes);
+    return block + HeaderSize;
+}
+
+void MemoryTracker::FreeObject(Category category, void* pointer)
+{
+    if (!s_isEnabled || pointer == NULL)
+    {
+        ::operator delete(pointer);
+        return;
+    }
+
+    char* block = static_cast<char*>(pointer) - HeaderSize;
+    Free(category, *reinterpret_cast<size_t*>(block));
+    ::operator delete(block);
+}
+
+std::vector<MemoryTracker::Stats> MemoryTracker::GetStats()
+{
+    std::vector<Stats> stats;
+    for (unsigned int i = 0; i < CategoryCount; i++)
+    {
+        stats.push_back({ s_categoryNames[i], s_liveBytes[i].load(), s_peakBytes[i].load(), s_allocations[i].load() });
+    }
+    return stats;
+}
+
+void MemoryTracker::PrintSummary(std::ostream& stream)
+{
+    stream << std::left << std::setw(14) << "Memory" << std::right << std::setw(14) << "Live bytes"
+           << std::setw(14) << "Peak bytes" << std::setw(14) << "Allocations" << '\n';
+    long long liveBytes = 0;
+    for (const Stats& category : GetStats())
+    {
+        stream << std::left << std::setw(14) << category.name << std::right << std::setw(14) << category.liveBytes
+               << std::setw(14) << category.peakBytes << std::setw(14) << category.allocations << '\n';
+        liveBytes += category.liveBytes;
+    }
+    stream << std::left << std::setw(14) << "Total" << std::right << std::setw(14) << liveBytes << '\n';
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+// Opt-in count of the memory held by the interpreter's main kinds of allocation. Tracking has to be
+// enabled before anything is allocated, since memory freed without having been counted would
+// make the totals wrong, and objects allocated while tracking carry a header that earlier ones
+// lack. So it can't be turned off again.
+class MemoryTracker
+{
+public:
+    enum class Category
+    {
+        Ast, // tree nodes, which are never freed
+        ValueString, // string contents too long to be kept inline
+        ValueArray,
+        SymbolTable, // scopes, modules and objects, not the variables in them
+        Token, // token text that isn't in a source, e.g. from cached modules
+        Count
+    };
+
+    struct Stats
+    {
+        const char* name;
+        long long liveBytes;
+        long long peakBytes;
+        unsigned long long allocations;
+    };
+
+    static void Enable();
+    static bool IsEnabled() { return s_isEnabled; }
+
+    static void Allocate(Category category, size_t bytes);
+    static void Free(Category category, size_t bytes);
+
+    // For class operator new and delete. The unsized operator delete is the one a class's delete
+    // calls, so while tracking, the size is kept in a header in front of the object.
+    static void* AllocateObject(Category category, size_t bytes);
+    static void FreeObject(Category category, void* pointer);
+
+    static std::vector<Stats> GetStats();
+    static void PrintSummary(std::ostream& stream);
+
+private:
+    static inline bool s_isEnabled = false;
+};
\ No newline at end of file
@@ -0,0 +1,180 @@
+#include "ModuleCache.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+#include "AstSerializer.hpp"
+#include "SourceFile.hpp"
+
+static const unsigned int CacheMagic = 0x43535050; // "PPSC"
+static const unsigned int CacheVersion = 2;
+
+static unsigned long long HashSource(std::string_view source)
+{
+    // FNV-1a
+    unsigned long long hash = 14695981039346656037ULL;
+    for (char c : source)
+    {
+        hash ^= (unsigned char)c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static bool GetSourceInfo(const std::string& sourcePath, unsigned long long& size, unsigned long long& modifiedTime)
+{
+    std::error_code error;
+    size = std::filesystem::file_size(sourcePath, error);
+    if (error)
+    {
+        return false;
+    }
+    modifiedTime = std::filesystem::last_write_time(sourcePath, error).time_since_epoch().count();
+    return !error;
+}
+
+ModuleCache::ModuleCache()
+    : m_mode(Mode::Enabled), m_directory("")
+{
+}
+
+ModuleCache::~ModuleCache()
+{
+}
+
+TokenNode* ModuleCache::Load(const std::string& sourcePath)
+{
+    if (m_mode != Mode::Enabled)
+    {
+        return NULL;
+    }
+
+    unsigned long long sourceSize, modifiedTime;
+    if (!GetSourceInfo(sourcePath, sourceSize, modifiedTime))
+    {
+        return NULL;
+    }
+
+    std::unique_ptr<SourceFile> entry = SourceFile::Open(getEntryPath(sourcePath));
+    if (!entry)
+    {
+        return NULL;
+    }
+
+    AstReader reader(entry->GetText().data(), entry->GetText().size());
+    if (reader.ReadUInt32() != CacheMagic || reader.ReadUInt32() != CacheVersion)
+    {
+        return NULL;
+    }
+
+    unsigned long long cachedSize = reader.ReadUInt64();
+    unsigned long long cachedTime = reader.ReadUInt64();
+    unsigned long long cachedHash = reader.ReadUInt64();
+    if (cachedSize != sourceSize)
+    {
+        return NULL;
+    }
+    if (cachedTime != modifiedTime)
+    {
+        // Touched but possibly unchanged, compare the contents
+        std::unique_ptr<SourceFile> source = SourceFile::Open(sourcePath);
+        if (!source || HashSource(source->GetText()) != cachedHash)
+        {
+            return NULL;
+        }
+    }
+
+    // The source is only read if an error needs a line and column from it
+    reader.SetBaseLocation(SourceMap::AddSource(sourcePath, sourceSize));
+    TokenNode* node = reader.ReadNode();
+    if (reader.HasError() || !reader.AtEnd())
+    {
+        return NULL;
+    }
+
+    // The tree's tokens view into the entry
+    SourceFile::Keep(std::move(entry));
+    return node;
+}
+
+void ModuleCache::Store(const std::string& sourcePath, const SourceFile* source, TokenNode* node)
+{
+    if (m_mode == Mode::Disabled || node == NULL)
+    {
+        return;
+    }
+
+    unsigned long long sourceSize, modifiedTime;
+    if (!GetSourceInfo(sourcePath, sourceSize, modifiedTime))
+    {
+        return;
+    }
+
+    AstWriter writer(source->GetBaseLocation());
+    writer.WriteUInt32(CacheMagic);
+    writer.WriteUInt32(CacheVersion);
+    writer.WriteUInt64(sourceSize);
+    writer.WriteUInt64(modifiedTime);
+    writer.WriteUInt64(HashSource(source->GetText()));
+    writer.WriteNode(node);
+
+    std::string entryPath = getEntryPath(sourcePath);
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(entryPath).parent_path(), error);
+    if (error)
+    {
+        return;
+    }
+
+    // Write to a temporary file first so a reader never sees a partial entry. Preloader threads, batch compiler
+    // workers and other processes can all store the same entry at once.
+    std::string tempPath = SourceFile::GetTempPath(entryPath);
+    std::ofstream file(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        return;
+    }
+    file.write(writer.GetData().data(), writer.GetData().size());
+    file.close();
+    if (file.fail())
+    {
+        std::filesystem::remove(tempPath, error);
+        return;
+    }
+    std::filesystem::rename(tempPath, entryPath, error);
+    if (error)
+    {
+        std::filesystem::remove(tempPath, error);
+    }
+}
+
+void ModuleCache::SetMode(Mode mode)
+{
+    m_mode = mode;
+}
+
+ModuleCache::Mode ModuleCache::GetMode() const
+{
+    return m_mode;
+}
+
+void ModuleCache::SetDirectory(const std::string& directory)
+{
+    m_directory = directory;
+}
+
+std::string ModuleCache::getEntryPath(const std::string& sourcePath) const
+{
+    std::filesystem::path path(sourcePath);
+    std::string entryName = path.filename().string() + ".psc";
+    if (m_directory.empty())
+    {
+        return (path.parent_path() / ".planetoid_cache" / entryName).string();
+    }
+
+    // A shared directory can hold modules from anywhere, so the name includes the full path
+    std::error_code error;
+    std::string fullPath = std::filesystem::absolute(path, error).lexically_normal().string();
+    return (std::filesystem::path(m_directory) / (std::to_string(HashSource(fullPath)) + "_" + entryName)).string();
+}
\ No newline at end of file
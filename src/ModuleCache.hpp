@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+
+class SourceFile;
+class TokenNode;
+
+// On-disk cache of parsed modules. Each entry stores the source's size, modification
+// time and hash next to the serialized tree, so unchanged modules skip the lexer and parser.
+class ModuleCache
+{
+public:
+    enum class Mode
+    {
+        Enabled,
+        Disabled, // Never read or write the cache
+        Rebuild // Ignore existing entries and write new ones
+    };
+
+    ModuleCache();
+    ~ModuleCache();
+
+    // Returns NULL if there is no valid entry for the module
+    TokenNode* Load(const std::string& sourcePath);
+    void Store(const std::string& sourcePath, const SourceFile* source, TokenNode* node);
+
+    void SetMode(Mode mode);
+    Mode GetMode() const;
+
+    // By default entries are kept in a .planetoid_cache directory next to each module
+    void SetDirectory(const std::string& directory);
+
+private:
+    Mode m_mode;
+    std::string m_directory;
+
+    std::string getEntryPath(const std::string& sourcePath) const;
+};
\ No newline at end of file
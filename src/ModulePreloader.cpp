@@ -0,0 +1,147 @@
+#include "ModulePreloader.hpp"
+
+#include <algorithm>
+#include <thread>
+
+#include "Lexer.hpp"
+#include "ModuleCache.hpp"
+#include "Parser.hpp"
+#include "SourceFile.hpp"
+#include "TokenNode.hpp"
+
+ModulePreloader::ModulePreloader(ModuleCache& moduleCache)
+    : m_moduleCache(moduleCache), m_threadCount(0)
+{
+}
+
+ModulePreloader::~ModulePreloader()
+{
+}
+
+void ModulePreloader::Preload(TokenNode* node, const std::string& directory)
+{
+    std::vector<std::string> paths;
+    findImports(node, directory, paths);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    queueImports(paths);
+    if (m_queue.empty())
+    {
+        return;
+    }
+    lock.unlock();
+
+    unsigned int threadCount = m_threadCount;
+    if (threadCount == 0)
+    {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    std::vector<std::thread> workers;
+    for (unsigned int i = 1; i < threadCount; i++)
+    {
+        workers.emplace_back(&ModulePreloader::work, this);
+    }
+    work();
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+bool ModulePreloader::Take(const std::string& path, Module& module)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_modules.find(path);
+    if (it == m_modules.end())
+    {
+        return false;
+    }
+    module = std::move(it->second);
+    m_modules.erase(it);
+    return true;
+}
+
+void ModulePreloader::Clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_modules.clear();
+}
+
+void ModulePreloader::SetThreadCount(unsigned int threadCount)
+{
+    m_threadCount = threadCount;
+}
+
+ModulePreloader::Module ModulePreloader::Load(const std::string& path, ModuleCache& moduleCache)
+{
+    Module module = { true, moduleCache.Load(path), {} };
+    if (module.node)
+    {
+        return module;
+    }
+
+    const SourceFile* source = SourceFile::Load(path);
+    if (source == nullptr)
+    {
+        module.exists = false;
+        return module;
+    }
+
+    // A tree going into the cache must be complete, so bodies are only left for later without one
+    Lexer lexer(source);
+    Parser parser(lexer);
+    parser.SetLazyFunctions(moduleCache.GetMode() == ModuleCache::Mode::Disabled);
+    module.node = parser.Parse();
+    module.errors = parser.GetErrors();
+    if (module.node)
+    {
+        moduleCache.Store(path, source, module.node);
+    }
+    return module;
+}
+
+void ModulePreloader::work()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_queue.empty())
+    {
+        std::string path = m_queue.front();
+        m_queue.pop_front();
+        lock.unlock();
+
+        Module module = Load(path, m_moduleCache);
+
+        lock.lock();
+        m_modules[path] = std::move(module);
+    }
+}
+
+void ModulePreloader::queueImports(const std::vector<std::string>& paths)
+{
+    for (const std::string& path : paths)
+    {
+        // The placeholder stops a module imported from several places being loaded twice
+        if (m_modules.emplace(path, Module { false, NULL, {} }).second)
+        {
+            m_queue.push_back(path);
+        }
+    }
+}
+
+void ModulePreloader::findImports(TokenNode* node, const std::string& directory, std::vector<std::string>& paths)
+{
+    // Only the script's own statements. Blocks and functions run in scopes of their own, where imports are rejected.
+    if (node == NULL || node->GetType() != NodeType::Sequence)
+    {
+        return;
+    }
+
+    for (TokenNode* child : dynamic_cast<SequenceNode*>(node)->GetNodes())
+    {
+        if (child != NULL && child->GetType() == NodeType::Import)
+        {
+            paths.push_back(SourceFile::ResolvePath(directory, std::string(child->GetToken().GetValue())));
+        }
+    }
+}
\ No newline at end of file
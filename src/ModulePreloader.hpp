@@ -0,0 +1,58 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Error.hpp"
+
+class ModuleCache;
+class TokenNode;
+
+// Loads the modules a script imports on a pool of threads before the script runs.
+// Imports still execute in order; they just find their tree ready.
+class ModulePreloader
+{
+public:
+    struct Module
+    {
+        bool exists;
+        // NULL if the module has a syntax error
+        TokenNode* node;
+        std::vector<Error> errors;
+    };
+
+    ModulePreloader(ModuleCache& moduleCache);
+    ~ModulePreloader();
+
+    // Returns once every module imported at the top level of node has been loaded or has failed.
+    // Imports anywhere else, modules' own included, are rejected when they run, so they aren't loaded.
+    // Import paths are relative to directory.
+    void Preload(TokenNode* node, const std::string& directory);
+
+    // Hands over a module loaded by Preload. path is as given by SourceFile::ResolvePath.
+    // Returns false if the path wasn't preloaded.
+    bool Take(const std::string& path, Module& module);
+    void Clear();
+
+    // 0 uses one thread per core
+    void SetThreadCount(unsigned int threadCount);
+
+    // Reads the module from the cache, or lexes and parses it and caches the result
+    static Module Load(const std::string& path, ModuleCache& moduleCache);
+
+private:
+    ModuleCache& m_moduleCache;
+    unsigned int m_threadCount;
+
+    std::mutex m_mutex;
+    std::unordered_map<std::string, Module> m_modules;
+    std::deque<std::string> m_queue;
+
+    void work();
+    // Queues imports that haven't been seen yet. Expects m_mutex to be held.
+    void queueImports(const std::vector<std::string>& paths);
+    static void findImports(TokenNode* node, const std::string& directory, std::vector<std::string>& paths);
+};
\ No newline at end of file
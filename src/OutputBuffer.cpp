@@ -0,0 +1,87 @@
+#include "OutputBuffer.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+OutputBuffer::OutputBuffer(std::streambuf* destination, size_t capacity)
+    : m_destination(destination)
+{
+    SetCapacity(capacity);
+}
+
+OutputBuffer::~OutputBuffer()
+{
+    sync();
+}
+
+OutputBuffer& OutputBuffer::InstallOnConsole(size_t capacity)
+{
+    // Never destroyed, so anything written while the program shuts down still has somewhere to go
+    static OutputBuffer* s_console = nullptr;
+    if (s_console == nullptr)
+    {
+        s_console = new OutputBuffer(std::cout.rdbuf(), capacity);
+        std::cout.rdbuf(s_console);
+        std::atexit([]() { std::cout.flush(); });
+    }
+    return *s_console;
+}
+
+void OutputBuffer::SetCapacity(size_t capacity)
+{
+    passOn();
+    m_buffer.resize(capacity);
+    setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+}
+
+OutputBuffer::int_type OutputBuffer::overflow(int_type ch)
+{
+    if (!passOn())
+    {
+        return traits_type::eof();
+    }
+    if (traits_type::eq_int_type(ch, traits_type::eof()))
+    {
+        return traits_type::not_eof(ch);
+    }
+    if (pptr() == epptr())
+    {
+        return m_destination->sputc(traits_type::to_char_type(ch));
+    }
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+    return ch;
+}
+
+std::streamsize OutputBuffer::xsputn(const char* data, std::streamsize count)
+{
+    if (count >= epptr() - pptr())
+    {
+        if (!passOn())
+        {
+            return 0;
+        }
+        // Too big to be worth copying
+        if (count >= (std::streamsize)m_buffer.size())
+        {
+            return m_destination->sputn(data, count);
+        }
+    }
+    std::memcpy(pptr(), data, count);
+    pbump((int)count);
+    return count;
+}
+
+int OutputBuffer::sync()
+{
+    return passOn() && m_destination->pubsync() != -1 ? 0 : -1;
+}
+
+bool OutputBuffer::passOn()
+{
+    std::streamsize count = pptr() - pbase();
+    bool isWritten = count == 0 || m_destination->sputn(pbase(), count) == count;
+    setp(m_buffer.data(), m_buffer.data() + m_buffer.size());
+    return isWritten;
+}
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <streambuf>
+#include <vector>
+
+// Collects what's written to a stream and passes it on in large blocks, instead of one write per insertion.
+// It's passed on when full and when the stream is flushed, which reading from std::cin does, since it's tied to std::cout.
+class OutputBuffer : public std::streambuf
+{
+public:
+    static const size_t DefaultCapacity = 64 * 1024;
+
+    OutputBuffer(std::streambuf* destination, size_t capacity = DefaultCapacity);
+    ~OutputBuffer() override;
+
+    // Buffers std::cout from now until the program exits, when it is flushed
+    static OutputBuffer& InstallOnConsole(size_t capacity = DefaultCapacity);
+
+    // Passes on what's buffered first. 0 passes every write straight on.
+    void SetCapacity(size_t capacity);
+
+protected:
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char* data, std::streamsize count) override;
+    int sync() override;
+
+private:
+    std::streambuf* m_destination;
+    std::vector<char> m_buffer;
+
+    bool passOn();
+};
\ No newline at end of file
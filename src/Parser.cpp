@@ -1,10 +1,42 @@
 #include "Parser.hpp"
 
-#include <iostream>
+#include <algorithm>
+
 #include "Error.hpp"
 
-Parser::Parser(const std::vector<Token>& tokens)
-    : m_tokens(tokens), m_index(0)
+// ==, !=, <, >, <= and >=, which is also how much of what follows a ! it negates
+static const unsigned int ComparisonPower = 2;
+
+// How tightly each binary operator holds its operands, or 0 if the token isn't one. All of them are left associative.
+static unsigned int GetBindingPower(Token::Type type)
+{
+    switch (type)
+    {
+    case Token::Type::ConditionalAnd:
+    case Token::Type::ConditionalOr:
+        return 1;
+    case Token::Type::IsEqual:
+    case Token::Type::IsNotEqual:
+    case Token::Type::LessThan:
+    case Token::Type::GreaterThan:
+    case Token::Type::LessThanOrEqual:
+    case Token::Type::GreaterThanOrEqual:
+        return ComparisonPower;
+    case Token::Type::Plus:
+    case Token::Type::Minus:
+        return 3;
+    case Token::Type::Multiply:
+    case Token::Type::Divide:
+        return 4;
+    case Token::Type::Power:
+        return 5;
+    default:
+        return 0;
+    }
+}
+
+Parser::Parser(Lexer& lexer)
+    : m_lexer(lexer), m_buffer(BufferSize, Token(Token::Type::None, "")), m_index(0), m_lexedCount(0), m_statementStart(NoLocation), m_lazyFunctions(false)
 {
 }
 
@@ -14,7 +46,37 @@ Parser::~Parser()
 
 TokenNode* Parser::Parse()
 {
-    return parseLines(false);
+    TokenNode* node = parseLines(false);
+    if (m_lexer.HasError() || !m_errors.empty())
+    {
+        return NULL;
+    }
+    return node;
+}
+
+std::vector<Error> Parser::GetErrors() const
+{
+    std::vector<Error> errors = m_lexer.GetErrors();
+    errors.insert(errors.end(), m_errors.begin(), m_errors.end());
+    std::stable_sort(errors.begin(), errors.end(), [](const Error& left, const Error& right)
+    {
+        return left.GetLocation() < right.GetLocation();
+    });
+    return errors;
+}
+
+void Parser::SetLazyFunctions(bool lazyFunctions)
+{
+    m_lazyFunctions = lazyFunctions;
+}
+
+std::vector<Error> Parser::Compile(LazyBlockNode* node)
+{
+    Lexer lexer(node->GetSource(), node->GetStart(), node->GetEnd());
+    Parser parser(lexer);
+    parser.SetLazyFunctions(true);
+    node->SetBlock(parser.Parse());
+    return parser.GetErrors();
 }
 
 void Parser::advance()
@@ -27,32 +89,83 @@ void Parser::recede()
     m_index--;
 }
 
-TokenNode* Parser::parseLines(bool isBlock)
+const Token& Parser::peek(int offset)
 {
-    unsigned int numOpenBraces = isBlock ? 1 : 0;
-    SequenceNode* node = new SequenceNode(Token(Token::Type::None, ""), {});
+    // Tokens are pulled from the lexer as the parser reaches them
+    unsigned int index = m_index + offset;
+    while (m_lexedCount <= index)
+    {
+        m_buffer[m_lexedCount % BufferSize] = m_lexer.NextToken();
+        m_lexedCount++;
+    }
+    return m_buffer[index % BufferSize];
+}
 
-    while (m_tokens[m_index].GetType() != Token::Type::EndOfFile)
+void Parser::reportError(const std::string& message, const std::string& detail)
+{
+    // Once the lexer has complained about a statement, the parser's view of it isn't worth reporting
+    const std::vector<Error>& lexerErrors = m_lexer.GetErrors();
+    if (!lexerErrors.empty() && lexerErrors.back().GetLocation() >= m_statementStart)
+    {
+        return;
+    }
+
+    // Statements that end early can fail in each enclosing block at the same token
+    SourceLocation location = peek().GetLocation();
+    if (!m_errors.empty() && m_errors.back().GetLocation() == location)
+    {
+        return;
+    }
+    m_errors.push_back(Error(message + detail, location));
+}
+
+void Parser::synchronize()
+{
+    // Skip the rest of a broken statement, stepping over any blocks inside it.
+    // Stops after a ';' or before the '}' that closes the enclosing block.
+    unsigned int depth = 0;
+    while (peek().GetType() != Token::Type::EndOfFile)
     {
-        if (m_tokens[m_index].GetType() == Token::Type::LeftBrace)
+        Token::Type type = peek().GetType();
+        if (type == Token::Type::LeftBrace)
         {
-            numOpenBraces++;
+            depth++;
         }
-        else if (m_tokens[m_index].GetType() == Token::Type::RightBrace)
+        else if (type == Token::Type::RightBrace)
         {
-            numOpenBraces--;
-            if (numOpenBraces < 0)
+            if (depth == 0)
             {
-                Error e("Unexpected '}'", Position("Parser", 0, 0, m_index));
-                std::cout << e.ToString() << '\n';
-                return NULL;
+                return;
             }
-            else if (numOpenBraces == 0 && isBlock)
+            depth--;
+        }
+        else if (type == Token::Type::Semicolon && depth == 0)
+        {
+            advance();
+            return;
+        }
+        advance();
+    }
+}
+
+TokenNode* Parser::parseLines(bool isBlock)
+{
+    SequenceNode* node = new SequenceNode(Token(Token::Type::None, ""), {});
+
+    while (peek().GetType() != Token::Type::EndOfFile)
+    {
+        if (peek().GetType() == Token::Type::RightBrace)
+        {
+            if (isBlock)
             {
                 return node;
             }
+            reportError("Unexpected '}'");
+            advance();
+            continue;
         }
 
+        m_statementStart = peek().GetLocation();
         TokenNode* line = parseLine();
         if (line)
         {
@@ -60,7 +173,7 @@ TokenNode* Parser::parseLines(bool isBlock)
         }
         else
         {
-            return NULL;
+            synchronize();
         }
     }
 
@@ -69,287 +182,245 @@ TokenNode* Parser::parseLines(bool isBlock)
 
 TokenNode* Parser::parseLine()
 {
-    TokenNode* node = parseComparisonSequence();
-    if (m_tokens[m_index].GetType() == Token::Type::Semicolon)
+    TokenNode* node = parseExpression();
+    if (node == NULL)
+    {
+        return NULL;
+    }
+    if (peek().GetType() == Token::Type::Semicolon)
     {
         advance();
         return node;
     }
     else
     {
-        Error e("Expected ';'", Position("Parser", 0, 0, m_index));
-        std::cout << e.ToString() << '\n';
+        reportError("Expected ';'");
         return NULL;
     }
 }
 
-TokenNode* Parser::parseComparisonSequence()
+TokenNode* Parser::parseExpression(unsigned int minPower)
 {
-    TokenNode* left = parseComparison();
-    while (m_tokens[m_index].GetType() == Token::Type::ConditionalAnd || m_tokens[m_index].GetType() == Token::Type::ConditionalOr)
+    TokenNode* left = parseFactor();
+    if (left == NULL)
     {
-        Token op = m_tokens[m_index];
-        advance();
-        TokenNode* right = parseComparison();
-        left = new BinaryOperationNode(op, left, right);
+        return NULL;
     }
 
-    return left;
-}
-
-TokenNode* Parser::parseComparison()
-{
-    // (!) Expression ([== | != | < | > | <= | >=] Expression)
-    // Not
-    bool isNot = false;
-    if (m_tokens[m_index].GetType() == Token::Type::LogicalNot)
+    while (true)
     {
-        if (m_tokens[m_index + 1].GetType() != Token::Type::LeftParenthesis)
+        Token op = peek();
+        unsigned int power = GetBindingPower(op.GetType());
+        if (power == 0 || power < minPower)
         {
-            Error e("Expected '(' after '!'", Position("Parser", 0, 0, m_index));
-            std::cout << e.ToString() << '\n';
-            return NULL;
+            return left;
         }
-        isNot = true;
-        advance();
-    }
-    TokenNode* left = parseExpression();
-
-    // Comparison
-    while (m_tokens[m_index].GetType() == Token::Type::IsEqual || m_tokens[m_index].GetType() == Token::Type::IsNotEqual ||
-        m_tokens[m_index].GetType() == Token::Type::LessThan || m_tokens[m_index].GetType() == Token::Type::GreaterThan ||
-        m_tokens[m_index].GetType() == Token::Type::LessThanOrEqual || m_tokens[m_index].GetType() == Token::Type::GreaterThanOrEqual)
-    {
-        Token op = m_tokens[m_index];
-        advance();
-        TokenNode* right = parseExpression();
-        left = new BinaryOperationNode(op, left, right);
-    }
-
-    if (isNot)
-    {
-        left = new UnaryOperationNode(Token(Token::Type::LogicalNot, "!"), left);
-    }
-    
-    return left;
-}
-
-TokenNode* Parser::parseExpression()
-{
-    TokenNode* left = parseTerm();
-
-    while (m_tokens[m_index].GetType() == Token::Type::Plus || m_tokens[m_index].GetType() == Token::Type::Minus)
-    {
-        Token op = m_tokens[m_index];
-        advance();
-        TokenNode* right = parseTerm();
-        left = new BinaryOperationNode(op, left, right);
-    }
-
-    return left;
-}
-
-TokenNode* Parser::parseTerm()
-{
-    TokenNode* left = parsePrimary();
-    while (m_tokens[m_index].GetType() == Token::Type::Multiply || m_tokens[m_index].GetType() == Token::Type::Divide)
-    {
-        Token op = m_tokens[m_index];
         advance();
-        TokenNode* right = parsePrimary();
-        left = new BinaryOperationNode(op, left, right);
-    }
-
-    return left;
-}
 
-TokenNode* Parser::parsePrimary()
-{
-    TokenNode* left = parseFactor();
-    while (m_tokens[m_index].GetType() == Token::Type::Power)
-    {
-        Token op = m_tokens[m_index];
-        advance();
-        TokenNode* right = parseFactor();
+        TokenNode* right = parseExpression(power + 1);
+        if (right == NULL)
+        {
+            return NULL;
+        }
         left = new BinaryOperationNode(op, left, right);
     }
-
-    return left;
 }
 
 TokenNode* Parser::parseFactor()
 {
-    if (m_tokens[m_index].GetType() == Token::Type::Number)
+    Token::Type type = peek().GetType();
+    if (type == Token::Type::Number)
     {
         advance();
-        return new TokenNode(m_tokens[m_index-1], NodeType::Number);   
+        return new TokenNode(peek(-1), NodeType::Number);   
     }
-    else if (m_tokens[m_index].GetType() == Token::Type::String)
+    else if (type == Token::Type::String)
     {
         advance();
-        return new TokenNode(m_tokens[m_index-1], NodeType::String);
+        return new TokenNode(peek(-1), NodeType::String);
     }
-    else if (m_tokens[m_index].GetType() == Token::Type::LeftParenthesis)
+    else if (type == Token::Type::LeftParenthesis)
     {
         advance();
-        TokenNode* node = parseComparisonSequence();
-        if (m_tokens[m_index].GetType() == Token::Type::RightParenthesis)
+        TokenNode* node = parseExpression();
+        if (node == NULL)
+        {
+            return NULL;
+        }
+        if (peek().GetType() == Token::Type::RightParenthesis)
         {
             advance();
             return node;
         }
         else
         {
-            Error e("Expected ')'", Position("Parser", 0, 0, m_index));
-            std::cout << e.ToString() << '\n';
+            reportError("Expected ')'");
             return NULL;
         }
     }
-    else if (m_tokens[m_index].GetType() == Token::Type::Plus || m_tokens[m_index].GetType() == Token::Type::Minus)
+    else if (type == Token::Type::Plus || type == Token::Type::Minus || type == Token::Type::LogicalNot)
     {
-        Token op = m_tokens[m_index];
+        Token op = peek();
+        if (op.GetType() == Token::Type::LogicalNot && peek(1).GetType() != Token::Type::LeftParenthesis)
+        {
+            reportError("Expected '(' after '!'");
+            return NULL;
+        }
         advance();
-        TokenNode* right = parseFactor();
+        // ! negates the whole comparison that follows it, so !(a) == b is !((a) == b).
+        // + and - take only the factor after them, so -2^2 is (-2)^2.
+        TokenNode* right = op.GetType() == Token::Type::LogicalNot ? parseExpression(ComparisonPower) : parseFactor();
+        if (right == NULL)
+        {
+            return NULL;
+        }
         return new UnaryOperationNode(op, right);
     }
-    else if (m_tokens[m_index].GetType() == Token::Type::LeftBracket)
+    else if (type == Token::Type::LeftBracket)
     {
         advance();
         ArgumentListNode* vals = dynamic_cast<ArgumentListNode*>(parseArrayInit());
+        if (vals == NULL)
+        {
+            return NULL;
+        }
         return new ArrayNode(Token(Token::Type::None, ""), vals->GetArguments());
     }
-    else if (m_tokens[m_index].GetType() == Token::Type::Identifier)
+    else if (type == Token::Type::Identifier)
     {
         return parseIdentifier();
     }
-    else if (m_tokens[m_index].GetType() == Token::Type::Keyword)
+    else if (type == Token::Type::Keyword)
     {
-        if (m_tokens[m_index].GetValue() == "if")
+        if (peek().GetValue() == "if")
         {
             return parseIfElse();
         }
-        else if (m_tokens[m_index].GetValue() == "while")
+        else if (peek().GetValue() == "while")
         {
             return parseWhile();
         }
-        else if (m_tokens[m_index].GetValue() == "do")
+        else if (peek().GetValue() == "do")
         {
             return parseDoWhile();
         }
-        else if (m_tokens[m_index].GetValue() == "for")
+        else if (peek().GetValue() == "for")
         {
             return parseFor();
         }
-        else if (m_tokens[m_index].GetValue() == "foreach")
+        else if (peek().GetValue() == "foreach")
         {
             return parseForEach();
         }
-        else if (m_tokens[m_index].GetValue() == "continue")
+        else if (peek().GetValue() == "continue")
         {
             advance();
-            return new TokenNode(Token(Token::Type::Keyword, "continue"), NodeType::Continue);
+            return new TokenNode(peek(-1), NodeType::Continue);
         }
-        else if (m_tokens[m_index].GetValue() == "break")
+        else if (peek().GetValue() == "break")
         {
             advance();
-            return new TokenNode(Token(Token::Type::Keyword, "break"), NodeType::Break);
+            return new TokenNode(peek(-1), NodeType::Break);
         }
-        else if (m_tokens[m_index].GetValue() == "return")
+        else if (peek().GetValue() == "return")
         {
-            Token returnToken = m_tokens[m_index];
+            Token returnToken = peek();
             advance();
-            TokenNode* node;
-            if (m_tokens[m_index].GetType() != Token::Type::Semicolon)
+            TokenNode* node = NULL;
+            if (peek().GetType() != Token::Type::Semicolon)
             {
-                node = parseComparisonSequence();
+                node = parseExpression();
+                if (node == NULL)
+                {
+                    return NULL;
+                }
             }
-            
+
             return new ReturnNode(returnToken, node);
         }
-        else if (m_tokens[m_index].GetValue() == "import")
+        else if (peek().GetValue() == "import")
         {
             advance();
-            if (m_tokens[m_index].GetType() == Token::Type::String)
+            if (peek().GetType() == Token::Type::String)
             {
-                Token node = m_tokens[m_index];
+                Token node = peek();
                 advance();
                 return new ImportNode(node);
             }
             else
             {
-                Error e("Expected string", Position("Parser", 0, 0, m_index));
-                std::cout << e.ToString() << '\n';
+                reportError("Expected string");
                 return NULL;
             }
         }
 
-        Error e("Unknown Keyword: ", Position("Parser", 0, 0, m_index));
-        std::cout << e.ToString() << m_tokens[m_index].ToString() << '\n';
+        reportError("Unknown Keyword: ", peek().ToString());
         return NULL;
     }
     
-    Error e("Unexpected token: ", Position("Parser", 0, 0, m_index));
-    std::cout << e.ToString() << m_tokens[m_index].ToString() << '\n';
+    reportError("Unexpected token: ", peek().ToString());
     return NULL;
 }
 
 TokenNode* Parser::parseIfElse()
 {
-    Token ifToken = m_tokens[m_index];
+    Token ifToken = peek();
     advance();
-    if (m_tokens[m_index].GetType() != Token::Type::LeftParenthesis)
+    if (peek().GetType() != Token::Type::LeftParenthesis)
     {
-        Error e("Expected '('", Position("Parser", 0, 0, m_index));
-        std::cout << e.ToString() << '\n';
+        reportError("Expected '('");
         return NULL;
     }
     advance();
-    TokenNode* condition = parseComparisonSequence();
-    if (m_tokens[m_index].GetType() != Token::Type::RightParenthesis)
+    TokenNode* condition = parseExpression();
+    if (condition == NULL)
+    {
+        return NULL;
+    }
+    if (peek().GetType() != Token::Type::RightParenthesis)
     {
-        Error e("Expected ')'", Position("Parser", 0, 0, m_index));
-        std::cout << e.ToString() << '\n';
+        reportError("Expected ')'");
         return NULL;
     }
     advance();
-    if (m_tokens[m_index].GetType() != Token::Type::LeftBrace)
+    if (peek().GetType() != Token::Type::LeftBrace)
     {
-        Error e("Expected '{'", Position("Parser", 0, 0, m_index));
-        std::cout << e.ToString() << '\n';
+        reportError("Expected '{'");
         return NULL;
     }
     advance();
     TokenNode* ifBody = parseLines(true);
-    if (m_tokens[m_index].GetType() != Token::Type::RightBrace)
+    if (peek().GetType() != Token::Type::RightBrace)
     {
-        Error e("Expected '}'", Position("Parser", 0, 0, m_index));
-        std::cout << e.ToString() << '\n';
+        reportError("Expected '}'");
         return NULL;
     }
     advance();
     TokenNode* elseBody = NULL;
-    while (m_tokens[m_index].GetType() == Token::Type::Keyword && m_tokens[m_index].GetValue() == "else")
+    while (peek().GetType() == Token::Type::Keyword && peek().GetValue() == "else")
     {
         advance();
         // If
-        if (m_tokens[m_index].GetType() == Token::Type::Keyword && m_tokens[m_index].GetValue() == "if")
+        if (peek().GetType() == Token::Type::Keyword && peek().GetValue() == "if")
         {
             elseBody = parseIfElse();
+            if (elseBody == NULL)
+            {
+                return NULL;
+            }
         }
         else
         {
-            if (m_tokens[m_index].GetType() != Token::Type::LeftBrace)
+            if (peek().GetType() != Token::Type::LeftBrace)
             {
-                Error e("Expected '{'", Position("Parser", 0, 0, m_index));
-                std::cout << e.ToString() << '\n';
+                reportError("Expected '{'");
                 return NULL;
             }
             advance();
             elseBody = parseLines(true);
-            if (m_tokens[m_index].GetType() != Token::Type::RightBrace)
+            if (peek().GetType() != Token::Type::RightBrace)
             {
-                Error e("Expected '}'", Position("Parser", 0, 0, m_index));
-                std::cout << e.ToString() << '\n';
+                reportError("Expected '}'");
                 return NULL;
             }
             advance();
@@ -360,40 +431,40 @@ TokenNode* Parser::parseIfElse()
 
 TokenNode* Parser::parseWhile()
 {
-    Token whileToken = m_tokens[m_index];
+    Token whileToken = peek();
     advance();
-    if (m_tokens[m_index].GetType() != Token::Type::LeftParenthesis)
+    if (peek().GetType() != Token::Type::LeftParenthesis)
     {
-        Error e("Expected '('", Position("Parser", 0, 0, m_index));
-        std::cout << e.ToString() << '\n';
+        reportError("Expected '('");
         return NULL;
     }
     advance();
-    TokenNode* condition = parseComparisonSequence();
-    if (m_tokens[m_index].GetType() != Token::Type::RightParenthesis)
+    TokenNode* condition = parseExpression();
+    if (condition == NULL)
+    {
+        return NULL;
+    }
+    if (peek().GetType() != Token::Type::RightParenthesis)
     {
-        Error e("Expected ')'", Position("Parser", 0, 0, m_index));
-        std::cout << e.ToString() << '\n';
+        reportError("Expected ')'");
         return NULL;
     }
     advance();
-    if (m_tokens[m_index].GetType() == Token::Type::Keyword && m_tokens[m_index].GetValue() == "do")
+    if (peek().GetType() == Token::Type::Keyword && peek().GetValue() == "do")
     {
         advance();
     }
 
-    if (m_tokens[m_index].GetType() != Token::Type::LeftBrace)
+    if (peek().GetType() != Token::Type::LeftBrace)
     {
-        Error e("Expected '{'", Position("Parser", 0, 0, m_index));
-        std::cout << e.ToString() << '\n';
+        reportError("Expected '{'");
         return NULL;
     }
     advance();
     TokenNode* body = parseLines(true);
-    if (m_tokens[m_index].GetType() != Token::Type::RightBrace)
+    if (peek().GetType() != Token::Type::RightBrace)
     {
-        Error e("Expected '}'", Position("Parser", 0, 0, m_index));
-        std::cout << e.ToString() << '\n';
+        reportError("Expected '}'");
         return NULL;
     }
     advance();
@@ -402,42 +473,41 @@ TokenNode* Parser::parseWhile()
 
 TokenNode* Parser::parseDoWhile()
 {
-    Token doToken = m_tokens[m_index];
+    Token doToken = peek();
     advance();
-    if (m_tokens[m_index].GetType() != Token::Type::LeftBrace)
+    if (peek().GetType() != Token::Type::LeftBrace)
     {
-        Error e("Expected '{'", Position("Parser", 0, 0, m_index));
-        std::cout << e.ToString() << '\n';
+        reportError("Expected '{'");
         return NULL;
     }
     advance();
     TokenNode* body = parseLines(true);
-    if (m_tokens[m_index].GetType() != Token::Type::RightBrace)
+    if (peek().GetType() != Token::Type::RightBrace)
     {
-        Error e("Expected '}'", Position("Parser", 0, 0, m_index));
-        std::cout << e.ToString() << '\n';
+        reportError("Expected '}'");
         return NULL;
     }
     advance();
-    if (m_tokens[m_index].GetType() != Token::Type::Keyword || m_tokens[m_index].GetValue() != "while")
+    if (peek().GetType() != Token::Type::Keyword || peek().GetValue() != "while")
     {
-        Error e("Expected 'while'", Position("Parser", 0, 0, m_index));
-        std::cout << e.ToString() << '\n';
+        reportError("Expected 'while'");
         return NULL;
     }
     advance();
-    if (m_tokens[m_index].GetType() != Token::Type::LeftParenthesis)
+    if (peek().GetType() != Token::Type::LeftParenthesis)
     {
-        Error e("Expected '('", Position("Parser", 0, 0, m_index));
-        std::cout << e.ToString() << '\n';
+        reportError("Expected '('");
         return NULL;
     }
     advance();
-    TokenNode* condition = parseComparisonSequence();
-    if (m_tokens[m_index].GetType() != Token::Type::RightParenthesis)
+    TokenNode* condition = parseExpression();
+    if (condition == NULL)
     {
-        Error e("Expected ')'", Position("Parser", 0, 0, m_index));
-        std::cout << e.ToString() << '\n';
+        return NULL;
+    }
+    if (peek().GetType() != Token::Type::RightParenthesis)
+    {
+        reportError("Expected ')'");
         return NULL;
     }
     advance();
@@ -446,51 +516,57 @@ TokenNode* Parser::parseDoWhile()
 
 TokenNode* Parser::parseFor()
 {
-    Token forToken = m_tokens[m_index];
+    Token forToken = peek();
     advance();
-    if (m_tokens[m_index].GetType() != Token::Type::LeftParenthesis)
+    if (peek().GetType() != Token::Type::LeftParenthesis)
     {
-        Error e("Expected '('", Position("Parser", 0, 0, m_index));
-        std::cout << e.ToString() << '\n';
+        reportError("Expected '('");
         return NULL;
     }
     advance();
     TokenNode* init = parseFactor();
-    if (m_tokens[m_index].GetType() != Token::Type::Semicolon)
+    if (init == NULL)
+    {
+        return NULL;
+    }
+    if (peek().GetType() != Token::Type::Semicolon)
     {
-        Error e("Expected ';'", Position("Parser", 0, 0, m_index));
-        std::cout << e.ToString() << '\n';
+        reportError("Expected ';'");
         return NULL;
     }
     advance();
-    TokenNode* condition = parseComparisonSequence();
-    if (m_tokens[m_index].GetType() != Token::Type::Semicolon)
+    TokenNode* condition = parseExpression();
+    if (condition == NULL)
     {
-        Error e("Expected ';'", Position("Parser", 0, 0, m_index));
-        std::cout << e.ToString() << '\n';
+        return NULL;
+    }
+    if (peek().GetType() != Token::Type::Semicolon)
+    {
+        reportError("Expected ';'");
         return NULL;
     }
     advance();
     TokenNode* increment = parseExpression();
-    if (m_tokens[m_index].GetType() != Token::Type::RightParenthesis)
+    if (increment == NULL)
+    {
+        return NULL;
+    }
+    if (peek().GetType() != Token::Type::RightParenthesis)
     {
-        Error e("Expected ')'", Position("Parser", 0, 0, m_index));
-        std::cout << e.ToString() << '\n';
+        reportError("Expected ')'");
         return NULL;
     }
     advance();
-    if (m_tokens[m_index].GetType() != Token::Type::LeftBrace)
+    if (peek().GetType() != Token::Type::LeftBrace)
     {
-        Error e("Expected '{'", Position("Parser", 0, 0, m_index));
-        std::cout << e.ToString() << '\n';
+        reportError("Expected '{'");
         return NULL;
     }
     advance();
     TokenNode* body = parseLines(true);
-    if (m_tokens[m_index].GetType() != Token::Type::RightBrace)
+    if (peek().GetType() != Token::Type::RightBrace)
     {
-        Error e("Expected '}'", Position("Parser", 0, 0, m_index));
-        std::cout << e.ToString() << '\n';
+        reportError("Expected '}'");
         return NULL;
     }
     advance();
@@ -500,42 +576,41 @@ TokenNode* Parser::parseFor()
 TokenNode* Parser::parseForEach()
 {
     advance();
-    if (m_tokens[m_index].GetType() != Token::Type::LeftParenthesis)
+    if (peek().GetType() != Token::Type::LeftParenthesis)
     {
-        Error e("Expected '('", Position("Parser", 0, 0, m_index));
-        std::cout << e.ToString() << '\n';
+        reportError("Expected '('");
         return NULL;
     }
     advance();
-    Token var = m_tokens[m_index];
+    Token var = peek();
     advance();
-    if (m_tokens[m_index].GetType() != Token::Type::Keyword || m_tokens[m_index].GetValue() != "in")
+    if (peek().GetType() != Token::Type::Keyword || peek().GetValue() != "in")
     {
-        Error e("Expected 'in'", Position("Parser", 0, 0, m_index));
-        std::cout << e.ToString() << '\n';
+        reportError("Expected 'in'");
         return NULL;
     }
     advance();
     TokenNode* array = parseFactor();
-    if (m_tokens[m_index].GetType() != Token::Type::RightParenthesis)
+    if (array == NULL)
     {
-        Error e("Expected ')'", Position("Parser", 0, 0, m_index));
-        std::cout << e.ToString() << '\n';
+        return NULL;
+    }
+    if (peek().GetType() != Token::Type::RightParenthesis)
+    {
+        reportError("Expected ')'");
         return NULL;
     }
     advance();
-    if (m_tokens[m_index].GetType() != Token::Type::LeftBrace)
+    if (peek().GetType() != Token::Type::LeftBrace)
     {
-        Error e("Expected '{'", Position("Parser", 0, 0, m_index));
-        std::cout << e.ToString() << '\n';
+        reportError("Expected '{'");
         return NULL;
     }
     advance();
     TokenNode* body = parseLines(true);
-    if (m_tokens[m_index].GetType() != Token::Type::RightBrace)
+    if (peek().GetType() != Token::Type::RightBrace)
     {
-        Error e("Expected '}'", Position("Parser", 0, 0, m_index));
-        std::cout << e.ToString() << '\n';
+        reportError("Expected '}'");
         return NULL;
     }
     advance();
@@ -544,66 +619,81 @@ TokenNode* Parser::parseForEach()
 
 TokenNode* Parser::parseIdentifier(Token object)
 {
-    Token var = m_tokens[m_index];
+    Token var = peek();
     advance();
-    if (m_tokens[m_index].GetType() == Token::Type::Equals)
+    if (peek().GetType() == Token::Type::Equals)
     {
         advance();
-        if (m_tokens[m_index].GetType() == Token::Type::LeftBracket)
+        if (peek().GetType() == Token::Type::LeftBracket)
         {
             advance();
             ArgumentListNode* vals = dynamic_cast<ArgumentListNode*>(parseArrayInit());
+            if (vals == NULL)
+            {
+                return NULL;
+            }
             return new ArrayInitNode(var, object, vals->GetArguments());
         }
-        else if (m_tokens[m_index].GetType() == Token::Type::Keyword && m_tokens[m_index].GetValue() == "func")
+        else if (peek().GetType() == Token::Type::Keyword && peek().GetValue() == "func")
         {
             return parseFunctionDefinition();
         }
-        else if (m_tokens[m_index].GetType() == Token::Type::Keyword && m_tokens[m_index].GetValue() == "object")
+        else if (peek().GetType() == Token::Type::Keyword && peek().GetValue() == "object")
         {
             return parseObjectDefinition();
         }
-        TokenNode* right = parseComparisonSequence();
+        TokenNode* right = parseExpression();
+        if (right == NULL)
+        {
+            return NULL;
+        }
         return new VariableAssignmentNode(var, object, right);
     }
-    else if (m_tokens[m_index].GetType() == Token::Type::LeftBracket)
+    else if (peek().GetType() == Token::Type::LeftBracket)
     {
         return parseArrayIndex(object);
     }
-    else if (m_tokens[m_index].GetType() == Token::Type::LeftParenthesis)
+    else if (peek().GetType() == Token::Type::LeftParenthesis)
     {
         return parseFunctionCall(object);
     }
-    else if (m_tokens[m_index].GetType() == Token::Type::Dot)
+    else if (peek().GetType() == Token::Type::Dot)
     {
         advance();
         std::string name;
         if (object.GetType() == Token::Type::Identifier)
-            name = object.GetValue() + "." + var.GetValue();
+            name = std::string(object.GetValue()) + "." + std::string(var.GetValue());
         else
-            name = var.GetValue();
+            name = std::string(var.GetValue());
 
-        return parseIdentifier(Token(var.GetType(), name));
+        return parseIdentifier(Token(var.GetType(), name, var.GetLocation()));
     }
     return new VarRetrievalNode(var, object);
 }
 
 TokenNode* Parser::parseArrayIndex(Token object)
 {
-    Token var = m_tokens[m_index - 1];
+    Token var = peek(-1);
     advance();
-    TokenNode* index = parseComparisonSequence();
-    if (m_tokens[m_index].GetType() != Token::Type::RightBracket)
+    TokenNode* index = parseExpression();
+    if (index == NULL)
+    {
+        return NULL;
+    }
+    if (peek().GetType() != Token::Type::RightBracket)
     {
-        Error e("Expected ']'", Position("Parser", 0, 0, m_index));
-        std::cout << e.ToString() << '\n';
+        reportError("Expected ']'");
         return NULL;
     }
     advance();
-    if (m_tokens[m_index].GetType() == Token::Type::Equals)
+    if (peek().GetType() == Token::Type::Equals)
     {
         advance();
-        TokenNode* right = parseComparisonSequence();
+        TokenNode* right = parseExpression();
+        if (right == NULL)
+        {
+            return NULL;
+        }
         return new ArrayAssignmentNode(var, object, index, right);
     }
     return new ArrayAccessNode(var, object, index);
@@ -612,17 +702,20 @@ TokenNode* Parser::parseArrayIndex(Token object)
 TokenNode* Parser::parseArrayInit(Token object)
 {
     std::vector<TokenNode*> args;
-    while (m_tokens[m_index].GetType() != Token::Type::RightBracket)
+    while (peek().GetType() != Token::Type::RightBracket)
     {
-        TokenNode* arg = parseComparisonSequence();
+        TokenNode* arg = parseExpression();
+        if (arg == NULL)
+        {
+            return NULL;
+        }
         args.push_back(arg);
-        if (m_tokens[m_index].GetType() != Token::Type::Comma && m_tokens[m_index].GetType() != Token::Type::RightBracket)
+        if (peek().GetType() != Token::Type::Comma && peek().GetType() != Token::Type::RightBracket)
         {
-            Error e("Expected ',' or ']'", Position("Parser", 0, 0, m_index));
-            std::cout << e.ToString() << '\n';
+            reportError("Expected ',' or ']'");
             return NULL;
         }
-        if (m_tokens[m_index].GetType() == Token::Type::Comma)
+        if (peek().GetType() == Token::Type::Comma)
         {
             advance();
         }
@@ -633,26 +726,33 @@ TokenNode* Parser::parseArrayInit(Token object)
 
 TokenNode* Parser::parseFunctionCall(Token object)
 {
-    Token func = m_tokens[m_index - 1];
+    Token func = peek(-1);
     advance();
     TokenNode* args = parseArgumentList();
+    if (args == NULL)
+    {
+        return NULL;
+    }
     return new FunctionCallNode(func, object, args);
 }
 
 TokenNode* Parser::parseArgumentList()
 {
     std::vector<TokenNode*> args;
-    while (m_tokens[m_index].GetType() != Token::Type::RightParenthesis)
+    while (peek().GetType() != Token::Type::RightParenthesis)
     {
-        TokenNode* arg = parseComparisonSequence();
+        TokenNode* arg = parseExpression();
+        if (arg == NULL)
+        {
+            return NULL;
+        }
         args.push_back(arg);
-        if (m_tokens[m_index].GetType() != Token::Type::Comma && m_tokens[m_index].GetType() != Token::Type::RightParenthesis)
+        if (peek().GetType() != Token::Type::Comma && peek().GetType() != Token::Type::RightParenthesis)
         {
-            Error e("Expected ',' or ')'", Position("Parser", 0, 0, m_index));
-            std::cout << e.ToString() << '\n';
+            reportError("Expected ',' or ')'");
             return NULL;
         }
-        if (m_tokens[m_index].GetType() == Token::Type::Comma)
+        if (peek().GetType() == Token::Type::Comma)
         {
             advance();
         }
@@ -663,62 +763,93 @@ TokenNode* Parser::parseArgumentList()
 
 TokenNode* Parser::parseFunctionDefinition(Token object)
 {
-    Token func = m_tokens[m_index - 2];
+    Token func = peek(-2);
     advance();
-    if (m_tokens[m_index].GetType() != Token::Type::LeftBrace)
+    if (peek().GetType() != Token::Type::LeftBrace)
     {
-        Error e("Expected '{'", Position("Parser", 0, 0, m_index));
-        std::cout << e.ToString() << '\n';
+        reportError("Expected '{'");
         return NULL;
     }
     advance();
-    TokenNode* body = parseLines(true);
-    if (m_tokens[m_index].GetType() != Token::Type::RightBrace)
+    // Offsets can't be found without a base location, so those bodies are parsed now
+    TokenNode* body = m_lazyFunctions && m_lexer.GetBaseLocation() != NoLocation ? skipFunctionBody() : parseLines(true);
+    if (body == NULL)
+    {
+        return NULL;
+    }
+    if (peek().GetType() != Token::Type::RightBrace)
     {
-        Error e("Expected '}'", Position("Parser", 0, 0, m_index));
-        std::cout << e.ToString() << '\n';
+        reportError("Expected '}'");
         return NULL;
     }
     advance();
     return new FunctionDefinitionNode(func, object, body);
 }
 
+TokenNode* Parser::skipFunctionBody()
+{
+    // The body still has to be lexed to find its closing brace, but no nodes are built for it
+    Token open = peek(-1);
+    size_t start = peek().GetLocation() - m_lexer.GetBaseLocation();
+    unsigned int depth = 0;
+    while (true)
+    {
+        Token::Type type = peek().GetType();
+        if (type == Token::Type::EndOfFile)
+        {
+            reportError("Expected '}'");
+            return NULL;
+        }
+        else if (type == Token::Type::LeftBrace)
+        {
+            depth++;
+        }
+        else if (type == Token::Type::RightBrace)
+        {
+            if (depth == 0)
+            {
+                break;
+            }
+            depth--;
+        }
+        advance();
+    }
+    size_t end = peek().GetLocation() - m_lexer.GetBaseLocation();
+    return new LazyBlockNode(open, m_lexer.GetSource(), start, end);
+}
+
 TokenNode* Parser::parseObjectDefinition(Token object)
 {
-    Token obj = m_tokens[m_index - 2];
+    Token obj = peek(-2);
     TokenNode* parent = NULL;
     advance();
-    if (m_tokens[m_index].GetType() == Token::Type::LeftParenthesis)
+    if (peek().GetType() == Token::Type::LeftParenthesis)
     {
         advance();
-        if (m_tokens[m_index].GetType() != Token::Type::Identifier)
+        if (peek().GetType() != Token::Type::Identifier)
         {
-            Error e("Expected identifier", Position("Parser", 0, 0, m_index));
-            std::cout << e.ToString() << '\n';
+            reportError("Expected identifier");
             return NULL;
         }
-        parent = new TokenNode(m_tokens[m_index], NodeType::Identifier);
+        parent = new TokenNode(peek(), NodeType::Identifier);
         advance();
-        if (m_tokens[m_index].GetType() != Token::Type::RightParenthesis)
+        if (peek().GetType() != Token::Type::RightParenthesis)
         {
-            Error e("Expected ')'", Position("Parser", 0, 0, m_index));
-            std::cout << e.ToString() << '\n';
+            reportError("Expected ')'");
             return NULL;
         }
         advance();
     }
-    if (m_tokens[m_index].GetType() != Token::Type::LeftBrace)
+    if (peek().GetType() != Token::Type::LeftBrace)
     {
-        Error e("Expected '{'", Position("Parser", 0, 0, m_index));
-        std::cout << e.ToString() << '\n';
+        reportError("Expected '{'");
         return NULL;
     }
     advance();
     TokenNode* body = parseObjectIdentifiers();
-    if (m_tokens[m_index].GetType() != Token::Type::RightBrace)
+    if (peek().GetType() != Token::Type::RightBrace)
     {
-        Error e("Expected '}'", Position("Parser", 0, 0, m_index));
-        std::cout << e.ToString() << '\n';
+        reportError("Expected '}'");
         return NULL;
     }
     advance();
@@ -727,39 +858,32 @@ TokenNode* Parser::parseObjectDefinition(Token object)
 
 TokenNode* Parser::parseObjectIdentifiers()
 {
-    unsigned int numOpenBraces = 1;
     SequenceNode* node = new SequenceNode(Token(Token::Type::None, ""), {});
 
-    while (m_tokens[m_index].GetType() != Token::Type::EndOfFile)
+    while (peek().GetType() != Token::Type::EndOfFile && peek().GetType() != Token::Type::RightBrace)
     {
-        if (m_tokens[m_index].GetType() == Token::Type::LeftBrace)
-        {
-            numOpenBraces++;
-        }
-        else if (m_tokens[m_index].GetType() == Token::Type::RightBrace)
+        if (peek().GetType() != Token::Type::Identifier)
         {
-            numOpenBraces--;
-            if (numOpenBraces == 0)
-            {
-                return node;
-            }
+            reportError("Expected identifier");
+            synchronize();
+            continue;
         }
 
+        m_statementStart = peek().GetLocation();
         TokenNode* line = parseIdentifier();
-        if (line)
+        if (line == NULL)
         {
-            node->AddNode(line);
-            if (m_tokens[m_index].GetType() != Token::Type::Semicolon)
-            {
-                Error e("Expected ';'", Position("Parser", 0, 0, m_index));
-                std::cout << e.ToString() << '\n';
-                return NULL;
-            }
-            advance();
+            synchronize();
+        }
+        else if (peek().GetType() != Token::Type::Semicolon)
+        {
+            reportError("Expected ';'");
+            synchronize();
         }
         else
         {
-            return NULL;
+            node->AddNode(line);
+            advance();
         }
     }
 
@@ -1,31 +1,53 @@
 #pragma once
 
+#include <string>
 #include <vector>
 
+#include "Error.hpp"
+#include "Lexer.hpp"
 #include "Token.hpp"
 #include "TokenNode.hpp"
 
 class Parser
 {
 public:
-    Parser(const std::vector<Token>& tokens);
+    Parser(Lexer& lexer);
     ~Parser();
 
+    // Returns NULL if the source has a syntax error. Parsing carries on past errors
+    // so that GetErrors can report all of them, lexer errors included, in source order.
+    // Nodes already built for a statement that then fails are leaked, like every other tree.
     TokenNode* Parse();
+    std::vector<Error> GetErrors() const;
+
+    // Leaves function bodies unparsed until they're first called. Off by default, since a
+    // body's syntax errors then only show up when it runs.
+    void SetLazyFunctions(bool lazyFunctions);
+    // Parses a lazy body, and any function defined in it lazily too. Returns the body's syntax errors.
+    static std::vector<Error> Compile(LazyBlockNode* node);
 private:
-    std::vector<Token> m_tokens;
+    // Enough to look two tokens back and one ahead of the current one
+    static const unsigned int BufferSize = 4;
+
+    Lexer& m_lexer;
+    std::vector<Token> m_buffer;
     unsigned int m_index;
+    unsigned int m_lexedCount;
+
+    std::vector<Error> m_errors;
+    SourceLocation m_statementStart;
+    bool m_lazyFunctions;
 
     void advance();
     void recede();
+    const Token& peek(int offset = 0);
+    void reportError(const std::string& message, const std::string& detail = "");
+    void synchronize();
 
     TokenNode* parseLines(bool isBlock);
     TokenNode* parseLine();
-    TokenNode* parseComparisonSequence();
-    TokenNode* parseComparison();
-    TokenNode* parseExpression();
-    TokenNode* parseTerm();
-    TokenNode* parsePrimary();
+    // Precedence climbing: parses operators that bind at least as tightly as minPower
+    TokenNode* parseExpression(unsigned int minPower = 1);
     TokenNode* parseFactor();
     TokenNode* parseIfElse();
     TokenNode* parseWhile();
@@ -42,6 +64,7 @@ private:
     TokenNode* parseArgumentList();
 
     TokenNode* parseFunctionDefinition(Token object = Token(Token::Type::None, ""));
+    TokenNode* skipFunctionBody();
     TokenNode* parseObjectDefinition(Token object = Token(Token::Type::None, ""));
     TokenNode* parseObjectIdentifiers();
 };
\ No newline at end of file
@@ -1,68 +1,96 @@
-#include <chrono>
+#include <cstdlib>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <system_error>
+#include <vector>
 
+#include "BatchCompiler.hpp"
+#include "Benchmark.hpp"
+#include "Error.hpp"
+#include "Instrumentation.hpp"
 #include "Interpreter.hpp"
 #include "Lexer.hpp"
+#include "MemoryTracker.hpp"
+#include "OutputBuffer.hpp"
 #include "Parser.hpp"
+#include "Profiler.hpp"
+#include "SourceFile.hpp"
 #include "SymbolTable.hpp"
 #include "Token.hpp"
+#include "Tracer.hpp"
 #include "Value.hpp"
 
 
 Interpreter G_interpreter;
+Benchmark G_benchmark;
 
-void Evaluate(const std::string& input, const std::string& source)
+// Returns NULL after printing every syntax error in the source. Every function body is parsed,
+// so a script with an error anywhere doesn't run; only imported modules leave bodies for later.
+TokenNode* ParseSource(const SourceFile* source)
 {
-    Lexer lexer(source, input);
-    std::vector<Token> tokens = lexer.generateTokens();
-
-    if (tokens.size() == 0)
-        return;
-
-    Parser parser(tokens);
+    Lexer lexer(source);
+    Parser parser(lexer);
     TokenNode* node = parser.Parse();
+    for (const Error& error : parser.GetErrors())
+    {
+        std::cout << error.ToString() << '\n';
+    }
+    return node;
+}
+
+// With keepState, what the source defines is still there for the next evaluation
+void Evaluate(const SourceFile* source, bool keepState = false)
+{
+    TokenNode* node = ParseSource(source);
 
     if (!node)
         return;
 
+    G_interpreter.PreloadModules(node);
     G_interpreter.Interpret(node);
-    G_interpreter.Reset();
+    if (keepState)
+        G_interpreter.EndRun();
+    else
+        G_interpreter.Reset();
 }
 
-void Bench(const std::string& input, const std::string& source)
+// Each run starts from an empty state, so this also clears anything defined before it
+void Bench(const SourceFile* source, const std::string& jsonPath = "")
 {
-    Lexer lexer(source, input);
-    std::vector<Token> tokens = lexer.generateTokens();
-
-    if (tokens.size() == 0)
+    if (!G_benchmark.Run(source, G_interpreter))
         return;
 
-    Parser parser(tokens);
-    TokenNode* node = parser.Parse();
+    G_benchmark.PrintSummary(std::cout);
+    if (!jsonPath.empty() && !G_benchmark.WriteJson(jsonPath))
+    {
+        std::cout << "Failed to write " << jsonPath << '\n';
+    }
+}
+
+// Runs a prelude and saves the state it leaves behind, for -restore to start from
+bool TakeSnapshot(const SourceFile* source, const std::string& path)
+{
+    TokenNode* node = ParseSource(source);
 
     if (!node)
-        return;
+        return false;
 
-    auto start = std::chrono::high_resolution_clock::now();
+    G_interpreter.PreloadModules(node);
     G_interpreter.Interpret(node);
-    auto end = std::chrono::high_resolution_clock::now();
-
-    std::cout << "Time: " << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << "ms\n";
+    if (!G_interpreter.SaveSnapshot(path))
+    {
+        std::cout << "Failed to write snapshot " << path << '\n';
+        return false;
+    }
+    std::cout << "Saved snapshot " << path << '\n';
+    return true;
 }
 
-void Verify(const std::string& input)
+void Verify(const SourceFile* source)
 {
-    Lexer lexer("eval", input);
-    std::vector<Token> tokens = lexer.generateTokens();
-    if (tokens.size() == 0)
-    {
-        std::cout << "Invalid input.\n";
-    }
-    
-    Parser parser(tokens);
-    TokenNode* node = parser.Parse();
+    TokenNode* node = ParseSource(source);
     if (!node)
     {
         std::cout << "Invalid input.\n";
@@ -73,10 +101,30 @@ void Verify(const std::string& input)
     }
 }
 
+// Input typed at the prompt is kept alongside loaded files, since tokens view into it
+const SourceFile* FromInput(const std::string& name, const std::string& input)
+{
+    return SourceFile::Keep(SourceFile::FromString(name, input));
+}
+
+const SourceFile* LoadFile(const std::string& path)
+{
+    std::cout << "Loading file " << path << '\n';
+    const SourceFile* source = SourceFile::Load(path);
+    if (source == nullptr)
+    {
+        std::cout << "Failed to open file.\n";
+    }
+    return source;
+}
+
 void RanAsExecutable()
 {
     // While the input isn't "exit", prompt for an input following a ">"
     // and print the input to the console.
+    // Variables, functions, objects and imports carry over from one input to the next until "reset".
+    // Loaded files are read rather than mapped, since they're kept all session and may be edited meanwhile.
+    SourceFile::SetMappingEnabled(false);
     std::string input;
     while (input != "exit")
     {
@@ -91,68 +139,40 @@ void RanAsExecutable()
             std::cout << "verify <...> - Verify an expression\n";
             std::cout << "verifyfile [filename] - Verify a file\n]";
             std::cout << "load [filename] - Load a file\n";
+            std::cout << "reset - Forget everything defined by earlier evals and loads\n";
             std::cout << "generate [filename] - Generate a file\n";
-            std::cout << "bench <...> - Benchmark an expression\n";
-            std::cout << "benchfile [filename] - Benchmark a file\n";
+            std::cout << "bench <...> - Benchmark an expression (clears the session)\n";
+            std::cout << "benchfile [filename] - Benchmark a file (clears the session)\n";
             std::cout << "exit - Exit the program\n";
         }
         else if (input.substr(0, 4) == "eval")
         {
-            Evaluate(input.substr(5, input.length()), "eval");
+            Evaluate(FromInput("eval", input.substr(5, input.length())), true);
         }
-        else if (input.substr(0, 6) == "verify")
+        else if (input.substr(0, 10) == "verifyfile")
         {
-            Verify(input.substr(7, input.length()));
+            const SourceFile* source = LoadFile(input.substr(11, input.length()));
+            if (source)
+                Verify(source);
         }
-        else if (input.substr(0, 10) == "verifyfile")
+        else if (input.substr(0, 6) == "verify")
         {
-            std::cout << "Loading file " << input.substr(5, input.length()) << '\n';
-            // Open the file using C++'s file I/O.
-            std::fstream file;
-            file.open(input.substr(5, input.length()), std::ios::in);
-            if (file.is_open())
-            {
-                // Load the file into a string.
-                std::string fileContents;
-                file.seekg(0, std::ios::end);
-                fileContents.resize(file.tellg());
-                file.seekg(0, std::ios::beg);
-                file.read(&fileContents[0], fileContents.size());
-                file.close();
-
-                // Evaluate the file.
-                Verify(fileContents);
-            }
-            else
-            {
-                std::cout << "Failed to open file.\n";
-            }
+            Verify(FromInput("eval", input.substr(7, input.length())));
         }
         else if (input.substr(0, 4) == "load")
         {
-            std::cout << "Loading file " << input.substr(5, input.length()) << '\n';
-            // Open the file using C++'s file I/O.
-            std::fstream file;
-            file.open(input.substr(5, input.length()), std::ios::in);
-            if (file.is_open())
-            {
-                // Load the file into a string.
-                std::string fileContents;
-                file.seekg(0, std::ios::end);
-                fileContents.resize(file.tellg());
-                file.seekg(0, std::ios::beg);
-                file.read(&fileContents[0], fileContents.size());
-                file.close();
-
-                // Evaluate the file.
-                G_interpreter.SetCurrentDirectory(input.substr(5, input.length()));
-                Evaluate(fileContents, input.substr(5, input.length()));
-            }
-            else
+            const SourceFile* source = LoadFile(input.substr(5, input.length()));
+            if (source)
             {
-                std::cout << "Failed to open file.\n";
+                G_interpreter.SetCurrentDirectory(source->GetName());
+                Evaluate(source, true);
             }
         }
+        else if (input == "reset")
+        {
+            G_interpreter.Reset();
+            std::cout << "State cleared.\n";
+        }
         else if (input.substr(0, 8) == "generate")
         {
             std::cout << "Generating file " << input.substr(9, input.length()) << '\n';
@@ -163,31 +183,13 @@ void RanAsExecutable()
         }
         else if (input.substr(0, 9) == "benchfile")
         {
-            std::cout << "Loading file " << input.substr(5, input.length()) << '\n';
-            // Open the file using C++'s file I/O.
-            std::fstream file;
-            file.open(input.substr(10, input.length()), std::ios::in);
-            if (file.is_open())
-            {
-                // Load the file into a string.
-                std::string fileContents;
-                file.seekg(0, std::ios::end);
-                fileContents.resize(file.tellg());
-                file.seekg(0, std::ios::beg);
-                file.read(&fileContents[0], fileContents.size());
-                file.close();
-
-                // Evaluate the file.
-                Bench(fileContents, input.substr(10, input.length()));
-            }
-            else
-            {
-                std::cout << "Failed to open file.\n";
-            }
+            const SourceFile* source = LoadFile(input.substr(10, input.length()));
+            if (source)
+                Bench(source);
         }
         else if (input.substr(0, 5) == "bench")
         {
-            Bench(input.substr(6, input.length()), "bench");
+            Bench(FromInput("bench", input.substr(6, input.length())));
         }
         else if (input != "exit")
         {
@@ -198,70 +200,228 @@ void RanAsExecutable()
 
 int main(int argc, char** argv) 
 {
+    // Before anything that writes at exit is registered, so that it's flushed after them
+    OutputBuffer& output = OutputBuffer::InstallOnConsole();
     std::cout << "PlanetoidScript v0.1\n";
-    switch (argc)
+#ifdef PLANETOID_INSTRUMENT
+    std::atexit([]() { Instrumentation::PrintSummary(std::cout); });
+#endif
+    if (argc == 1)
     {
-        case 1:
-            RanAsExecutable();
-            break;
-        case 2:
-            {
-                std::cout << "Loading file " << argv[1] << '\n';
-                // Open the file using C++'s file I/O.
-                std::fstream file;
-                file.open(argv[1], std::ios::in);
-                if (file.is_open())
-                {
-                    // Load the file into a string.
-                    std::string fileContents;
-                    file.seekg(0, std::ios::end);
-                    fileContents.resize(file.tellg());
-                    file.seekg(0, std::ios::beg);
-                    file.read(&fileContents[0], fileContents.size());
-                    file.close();
+        RanAsExecutable();
+        return 0;
+    }
 
-                    // Evaluate the file.
-                    G_interpreter.SetCurrentDirectory(argv[1]);
-                    Evaluate(fileContents, argv[1]);
-                }
+    std::string mode = "";
+    std::vector<std::string> paths;
+    std::string snapshotPath = "";
+    std::string restorePath = "";
+    std::string jsonPath = "";
+    std::string profilePath = "";
+    std::string tracePath = "";
+    bool showMemoryStats = false;
+    unsigned int threadCount = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "-bench" || arg == "-verify" || arg == "-compile")
+        {
+            mode = arg;
+        }
+        else if (arg == "-snapshot" && i + 1 < argc)
+        {
+            mode = arg;
+            snapshotPath = argv[++i];
+        }
+        else if (arg == "-restore" && i + 1 < argc)
+        {
+            restorePath = argv[++i];
+        }
+        else if ((arg == "-runs" || arg == "-warmup") && i + 1 < argc)
+        {
+            try
+            {
+                unsigned int runs = std::stoul(argv[++i]);
+                if (arg == "-runs")
+                    G_benchmark.SetRuns(runs);
                 else
-                {
-                    std::cout << "Failed to open file.\n";
-                }
+                    G_benchmark.SetWarmupRuns(runs);
+            }
+            catch (const std::exception& e)
+            {
+                std::cout << "Invalid run count " << argv[i] << '\n';
+                return 1;
+            }
+        }
+        else if (arg == "-json" && i + 1 < argc)
+        {
+            jsonPath = argv[++i];
+        }
+        else if (arg == "-profile" && i + 1 < argc)
+        {
+            profilePath = argv[++i];
+        }
+        else if (arg == "-trace" && i + 1 < argc)
+        {
+            tracePath = argv[++i];
+        }
+        else if (arg == "-memstats")
+        {
+            // Nothing the script allocates has been allocated yet
+            showMemoryStats = true;
+            MemoryTracker::Enable();
+        }
+        else if (arg == "-unbuffered")
+        {
+            output.SetCapacity(0);
+        }
+        else if (arg == "-nocache")
+        {
+            G_interpreter.GetModuleCache().SetMode(ModuleCache::Mode::Disabled);
+        }
+        else if (arg == "-rebuildcache")
+        {
+            G_interpreter.GetModuleCache().SetMode(ModuleCache::Mode::Rebuild);
+        }
+        else if (arg == "-cachedir" && i + 1 < argc)
+        {
+            G_interpreter.GetModuleCache().SetDirectory(argv[++i]);
+        }
+        else if (arg == "-maxdepth" && i + 1 < argc)
+        {
+            try
+            {
+                G_interpreter.SetMaxCallDepth(std::stoul(argv[++i]));
+            }
+            catch (const std::exception& e)
+            {
+                std::cout << "Invalid call depth " << argv[i] << '\n';
+                return 1;
             }
-            break;
-        case 3:
+        }
+        else if (arg == "-jobs" && i + 1 < argc)
+        {
+            try
             {
-                std::cout << "Loading file " << argv[1] << '\n';
-                // Open the file using C++'s file I/O.
-                std::fstream file;
-                file.open(argv[1], std::ios::in);
-                if (file.is_open())
-                {
-                    // Load the file into a string.
-                    std::string fileContents;
-                    file.seekg(0, std::ios::end);
-                    fileContents.resize(file.tellg());
-                    file.seekg(0, std::ios::beg);
-                    file.read(&fileContents[0], fileContents.size());
-                    file.close();
+                threadCount = std::stoul(argv[++i]);
+                G_interpreter.GetModulePreloader().SetThreadCount(threadCount);
+            }
+            catch (const std::exception& e)
+            {
+                std::cout << "Invalid job count " << argv[i] << '\n';
+                return 1;
+            }
+        }
+        else if (arg[0] != '-')
+        {
+            paths.push_back(arg);
+        }
+        else
+        {
+            std::cout << "Invalid argument " << arg << '\n';
+            return 1;
+        }
+    }
 
-                    G_interpreter.SetCurrentDirectory(argv[1]);
-                    if (std::string(argv[2]) == "-bench")
-                        Bench(fileContents, argv[1]);
-                    else if (std::string(argv[2]) == "-verify")
-                        Verify(fileContents);
-                    else
-                        std::cout << "Invalid argument " << argv[2] << '\n';
-                }
-                else
-                {
-                    std::cout << "Failed to open file.\n";
-                }
+    if (paths.empty())
+    {
+        std::cout << "No file given.\n";
+        return 1;
+    }
+
+    std::error_code error;
+    if (mode == "-compile" || (mode == "-verify" && (paths.size() > 1 || std::filesystem::is_directory(paths[0], error))))
+    {
+        BatchCompiler batch(mode == "-compile" ? BatchCompiler::Mode::Compile : BatchCompiler::Mode::Verify, G_interpreter.GetModuleCache());
+        batch.SetThreadCount(threadCount);
+        for (const std::string& path : paths)
+        {
+            if (!batch.AddPath(path))
+            {
+                std::cout << "No such file or directory " << path << '\n';
+                return 1;
             }
-            break;
-        default:
-            std::cout << "Invalid arguments" << '\n';
-            break;
+        }
+        return batch.Run() == 0 ? 0 : 1;
     }
-}
+    else if (paths.size() > 1)
+    {
+        std::cout << "Only -verify and -compile take more than one file.\n";
+        return 1;
+    }
+
+    const SourceFile* source = LoadFile(paths[0]);
+    if (source == nullptr)
+    {
+        return 1;
+    }
+
+    if (!restorePath.empty() && !G_interpreter.RestoreSnapshot(restorePath))
+    {
+        std::cout << "Invalid snapshot " << restorePath << '\n';
+        return 1;
+    }
+
+    Profiler profiler;
+    if (!profilePath.empty())
+    {
+        G_interpreter.SetProfiler(&profiler);
+        profiler.Start();
+    }
+
+    Tracer tracer;
+    if (!tracePath.empty())
+    {
+        G_interpreter.SetTracer(&tracer);
+    }
+
+    G_benchmark.SetSnapshot(restorePath);
+    G_interpreter.SetCurrentDirectory(paths[0]);
+    int result = 0;
+    if (mode == "-snapshot")
+        result = TakeSnapshot(source, snapshotPath) ? 0 : 1;
+    else if (mode == "-bench")
+        Bench(source, jsonPath);
+    else if (mode == "-verify")
+        Verify(source);
+    else
+        Evaluate(source);
+    // Before anything else is written, so the last statement isn't charged for it
+    if (!profilePath.empty())
+    {
+        profiler.Stop();
+    }
+
+    if (!tracePath.empty())
+    {
+        G_interpreter.SetTracer(nullptr);
+        if (!tracer.Write(tracePath))
+        {
+            std::cout << "Failed to write " << tracePath << '\n';
+            return 1;
+        }
+        std::cout << "Trace: " << tracer.GetEventCount() << " events written to " << tracePath;
+        if (tracer.GetDroppedCount() != 0)
+        {
+            std::cout << ", " << tracer.GetDroppedCount() << " dropped once the buffer was full";
+        }
+        std::cout << '\n';
+    }
+
+    if (showMemoryStats)
+    {
+        MemoryTracker::PrintSummary(std::cout);
+    }
+
+    if (!profilePath.empty())
+    {
+        G_interpreter.SetProfiler(nullptr);
+        profiler.PrintSummary(std::cout);
+        if (!profiler.Write(profilePath))
+        {
+            std::cout << "Failed to write " << profilePath << '\n';
+            return 1;
+        }
+    }
+    return result;
+}
\ No newline at end of file
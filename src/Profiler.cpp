@@ -0,0 +1,190 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <unordered_map>
+#include <vector>
+
+Profiler::Profiler()
+    : m_intervalMicroseconds(1000), m_pendingTicks(0), m_isRunning(false), m_sampleCount(0), m_location(NoLocation), m_stack("main")
+{
+}
+
+Profiler::~Profiler()
+{
+    Stop();
+}
+
+void Profiler::Start(unsigned int intervalMicroseconds)
+{
+    Stop();
+    m_intervalMicroseconds = std::max(1u, intervalMicroseconds);
+    m_pendingTicks = 0;
+    m_location = NoLocation;
+    m_stack = "main";
+    m_callers.clear();
+    m_isRunning = true;
+    m_timer = std::thread([this]()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto next = std::chrono::steady_clock::now();
+        while (m_isRunning)
+        {
+            next += std::chrono::microseconds(m_intervalMicroseconds);
+            if (!m_condition.wait_until(lock, next, [this]() { return !m_isRunning; }))
+            {
+                m_pendingTicks.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    });
+}
+
+void Profiler::Stop()
+{
+    if (!m_timer.joinable())
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_isRunning = false;
+    }
+    m_condition.notify_all();
+    m_timer.join();
+    record();
+}
+
+void Profiler::EnterCall(const std::string& functionName)
+{
+    // The caller's stack takes the ticks up to the call
+    record();
+    m_callers.emplace_back(m_location, m_stack.size());
+    m_stack += ';';
+    m_stack += functionName;
+}
+
+void Profiler::ExitCall()
+{
+    if (m_callers.empty())
+    {
+        return;
+    }
+    // The callee's last statement takes the ticks up to the return, and the caller's statement carries on
+    record();
+    m_location = m_callers.back().first;
+    m_stack.resize(m_callers.back().second);
+    m_callers.pop_back();
+}
+
+void Profiler::ReplaceCall(const std::string& functionName)
+{
+    if (m_callers.empty())
+    {
+        return;
+    }
+    record();
+    m_stack.resize(m_callers.back().second);
+    m_stack += ';';
+    m_stack += functionName;
+}
+
+bool Profiler::Write(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    for (const auto& sample : m_samples)
+    {
+        file << sample.first.first << ';' << getLineName(sample.first.second) << ' ' << sample.second << '\n';
+    }
+    file.close();
+    return !file.fail();
+}
+
+void Profiler::PrintSummary(std::ostream& stream, unsigned int count) const
+{
+    // A function's self samples are those taken in it, its total ones those taken anywhere beneath it
+    std::unordered_map<std::string, unsigned long long> selfSamples;
+    std::unordered_map<std::string, unsigned long long> totalSamples;
+    std::unordered_map<std::string, unsigned long long> lineSamples;
+    for (const auto& sample : m_samples)
+    {
+        const std::string& stack = sample.first.first;
+        std::vector<std::string> names;
+        for (size_t start = 0, end = 0; end != std::string::npos; start = end + 1)
+        {
+            end = stack.find(';', start);
+            std::string name = stack.substr(start, end == std::string::npos ? std::string::npos : end - start);
+            // Recursive functions count once towards their total
+            if (std::find(names.begin(), names.end(), name) == names.end())
+            {
+                totalSamples[name] += sample.second;
+                names.push_back(name);
+            }
+        }
+        selfSamples[stack.substr(stack.rfind(';') + 1)] += sample.second;
+        lineSamples[getLineName(sample.first.second)] += sample.second;
+    }
+
+    auto printTop = [&stream, count, this](const std::string& title, const std::unordered_map<std::string, unsigned long long>& samples,
+        const std::unordered_map<std::string, unsigned long long>* totals)
+    {
+        std::vector<std::pair<std::string, unsigned long long>> sorted(samples.begin(), samples.end());
+        std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b)
+        {
+            return a.second != b.second ? a.second > b.second : a.first < b.first;
+        });
+
+        stream << title << '\n';
+        for (size_t i = 0; i < sorted.size() && i < count; i++)
+        {
+            stream << "  " << std::setw(6) << std::fixed << std::setprecision(1) << 100.0 * sorted[i].second / m_sampleCount << "% ";
+            if (totals)
+            {
+                stream << std::setw(6) << 100.0 * totals->at(sorted[i].first) / m_sampleCount << "% ";
+            }
+            stream << sorted[i].first << '\n';
+        }
+        stream << std::defaultfloat << std::setprecision(6);
+    };
+
+    stream << "Profile: " << m_sampleCount << " samples, every " << m_intervalMicroseconds << "us\n";
+    if (m_sampleCount == 0)
+    {
+        return;
+    }
+    printTop("   self  total function", selfSamples, &totalSamples);
+    printTop("   self line", lineSamples, nullptr);
+}
+
+void Profiler::EndRun()
+{
+    record();
+    m_location = NoLocation;
+    m_stack = "main";
+    m_callers.clear();
+}
+
+void Profiler::record()
+{
+    unsigned int ticks = m_pendingTicks.exchange(0, std::memory_order_relaxed);
+    // Ticks before the first statement, while the script was still being read, aren't the script's
+    if (ticks == 0 || m_location == NoLocation)
+    {
+        return;
+    }
+    m_samples[{ m_stack, m_location }] += ticks;
+    m_sampleCount += ticks;
+}
+
+std::string Profiler::getLineName(SourceLocation location)
+{
+    // Lines are looked up once per distinct sample rather than while the script runs
+    Position position = SourceMap::Resolve(location);
+    return position.GetFileName() + ":" + std::to_string(position.GetLine());
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "SourceMap.hpp"
+
+// Samples where a script spends its time. A timer thread counts ticks, and the interpreter hands
+// pending ticks to the script call stack and line that was running when they came in: each statement
+// takes the ticks that arrived since it started, collected when the next statement starts or the call
+// stack changes. So the timer never touches interpreter state. Samples are written as collapsed stacks
+// ("main;outer;inner;file.txt:12 count"), which flame graph tools read directly.
+class Profiler
+{
+public:
+    Profiler();
+    ~Profiler();
+
+    void Start(unsigned int intervalMicroseconds = 1000);
+    // Ticks pending for the last statement are given to it
+    void Stop();
+
+    // Called before each statement runs
+    void Poll(SourceLocation location)
+    {
+        if (location == NoLocation)
+        {
+            return;
+        }
+        if (m_pendingTicks.load(std::memory_order_relaxed) != 0)
+        {
+            record();
+        }
+        m_location = location;
+    }
+
+    // Called once a script function's frame is pushed, before it is popped, and before a tail call reuses it
+    void EnterCall(const std::string& functionName);
+    void ExitCall();
+    void ReplaceCall(const std::string& functionName);
+    // Called when a run ends. The last statement takes the pending ticks, and ticks from then until the
+    // next statement, such as freeing what the run left behind, aren't charged to any.
+    void EndRun();
+
+    bool Write(const std::string& path) const;
+    // The functions and lines with the most samples
+    void PrintSummary(std::ostream& stream, unsigned int count = 10) const;
+
+private:
+    unsigned int m_intervalMicroseconds;
+    std::atomic<unsigned int> m_pendingTicks;
+
+    std::thread m_timer;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_isRunning;
+
+    // Samples by the function names on the stack, outermost first, and the line being run
+    std::map<std::pair<std::string, SourceLocation>, unsigned long long> m_samples;
+    unsigned long long m_sampleCount;
+
+    // The statement running and its stack, as written in a sample ("main;outer;inner")
+    SourceLocation m_location;
+    std::string m_stack;
+    // For each call, the statement its caller was running and the length of m_stack before the call
+    std::vector<std::pair<SourceLocation, size_t>> m_callers;
+
+    // Gives the pending ticks to the running statement
+    void record();
+    static std::string getLineName(SourceLocation location);
+};
\ No newline at end of file
@@ -0,0 +1,59 @@
+#include "Random.hpp"
+
+#include <chrono>
+#include <random>
+
+// Spreads a seed over the whole state, so that similar seeds still give unrelated sequences
+static uint64_t SplitMix64(uint64_t& state)
+{
+    uint64_t result = (state += 0x9E3779B97F4A7C15ull);
+    result = (result ^ (result >> 30)) * 0xBF58476D1CE4E5B9ull;
+    result = (result ^ (result >> 27)) * 0x94D049BB133111EBull;
+    return result ^ (result >> 31);
+}
+
+Random::Random(uint64_t seed)
+{
+    Seed(seed);
+}
+
+Random::~Random()
+{
+}
+
+void Random::Seed(uint64_t seed)
+{
+    for (uint64_t& state : m_state)
+    {
+        state = SplitMix64(seed);
+    }
+}
+
+void Random::SeedFromDevice()
+{
+    // random_device may be deterministic on some platforms, so the clock is mixed in
+    std::random_device device;
+    uint64_t seed = ((uint64_t)device() << 32) | device();
+    Seed(seed ^ (uint64_t)std::chrono::high_resolution_clock::now().time_since_epoch().count());
+}
+
+void Random::GetState(uint64_t state[StateSize]) const
+{
+    for (unsigned int i = 0; i < StateSize; i++)
+    {
+        state[i] = m_state[i];
+    }
+}
+
+bool Random::SetState(const uint64_t state[StateSize])
+{
+    if ((state[0] | state[1] | state[2] | state[3]) == 0)
+    {
+        return false;
+    }
+    for (unsigned int i = 0; i < StateSize; i++)
+    {
+        m_state[i] = state[i];
+    }
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+// xoshiro256** generator. Unlike rand() it is owned by whoever uses it, and a seed gives the
+// same numbers on every platform.
+class Random
+{
+public:
+    static const uint64_t DefaultSeed = 1;
+    static const unsigned int StateSize = 4;
+
+    Random(uint64_t seed = DefaultSeed);
+    ~Random();
+
+    void Seed(uint64_t seed);
+    // For when no seed is given, so each run differs
+    void SeedFromDevice();
+
+    // Where the generator is in its sequence, so a snapshot can resume from there
+    void GetState(uint64_t state[StateSize]) const;
+    // Returns false, leaving the generator as it was, for the all-zero state it can't reach or leave
+    bool SetState(const uint64_t state[StateSize]);
+
+    uint64_t Next()
+    {
+        uint64_t result = rotateLeft(m_state[1] * 5, 7) * 9;
+        uint64_t shifted = m_state[1] << 17;
+        m_state[2] ^= m_state[0];
+        m_state[3] ^= m_state[1];
+        m_state[1] ^= m_state[2];
+        m_state[0] ^= m_state[3];
+        m_state[2] ^= shifted;
+        m_state[3] = rotateLeft(m_state[3], 45);
+        return result;
+    }
+
+    // Uniform in [min, max)
+    float NextFloat(float min, float max)
+    {
+        // The top 24 bits fill a float's mantissa exactly. Their product with the range is exact as a double,
+        // so the result doesn't depend on whether the compiler fuses the multiply and add.
+        double unit = (double)(Next() >> 40) * (1.0 / 16777216.0);
+        float result = (float)(unit * (double)(max - min) + (double)min);
+        // Rounding to a float can land on max when the range is small next to max, e.g. [100, 101)
+        return result == max && max != min ? std::nextafter(max, min) : result;
+    }
+
+private:
+    uint64_t m_state[StateSize];
+
+    static uint64_t rotateLeft(uint64_t value, int count)
+    {
+        return (value << count) | (value >> (64 - count));
+    }
+};
\ No newline at end of file
@@ -0,0 +1,279 @@
+#include "Snapshot.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <system_error>
+
+#include "AstSerializer.hpp"
+#include "MemoCache.hpp"
+#include "Parser.hpp"
+#include "Random.hpp"
+#include "SourceFile.hpp"
+#include "SymbolTable.hpp"
+#include "TokenNode.hpp"
+
+static const unsigned int SnapshotMagic = 0x49535050; // "PPSI"
+static const unsigned int SnapshotVersion = 2;
+
+// The first location in a tree, which tells which source it came from
+static SourceLocation FindLocation(TokenNode* node)
+{
+    if (node == NULL)
+    {
+        return NoLocation;
+    }
+    if (node->GetLocation() != NoLocation)
+    {
+        return node->GetLocation();
+    }
+    if (node->GetType() == NodeType::Sequence)
+    {
+        for (TokenNode* child : dynamic_cast<SequenceNode*>(node)->GetNodes())
+        {
+            SourceLocation location = FindLocation(child);
+            if (location != NoLocation)
+            {
+                return location;
+            }
+        }
+    }
+    return NoLocation;
+}
+
+BodyTable::BodyTable()
+{
+}
+
+BodyTable::~BodyTable()
+{
+}
+
+unsigned int BodyTable::Add(TokenNode* body)
+{
+    auto it = m_indices.emplace(body, m_bodies.size());
+    if (it.second)
+    {
+        m_bodies.push_back(body);
+    }
+    return it.first->second;
+}
+
+bool BodyTable::Find(const TokenNode* body, unsigned int& index) const
+{
+    auto it = m_indices.find(body);
+    if (it == m_indices.end())
+    {
+        return false;
+    }
+    index = it->second;
+    return true;
+}
+
+TokenNode* BodyTable::Get(unsigned int index) const
+{
+    return index < m_bodies.size() ? m_bodies[index] : NULL;
+}
+
+const std::vector<TokenNode*>& BodyTable::GetBodies() const
+{
+    return m_bodies;
+}
+
+Snapshot::Snapshot()
+{
+}
+
+Snapshot::~Snapshot()
+{
+}
+
+bool Snapshot::Save(const std::string& path, const SymbolTable& globalTable, const MemoCache& memoCache,
+    const std::unordered_set<const TokenNode*>& memoizedFunctions, const Random& random)
+{
+    m_bodies = BodyTable();
+
+    // Tables first, since that's what finds the bodies. Memoized bodies no table holds can't be called after a restore.
+    AstWriter tables;
+    globalTable.Write(tables, m_bodies);
+
+    AstWriter state;
+    std::vector<unsigned int> memoized;
+    for (const TokenNode* body : memoizedFunctions)
+    {
+        unsigned int index;
+        if (m_bodies.Find(body, index))
+        {
+            memoized.push_back(index);
+        }
+    }
+    state.WriteUInt32(memoized.size());
+    for (unsigned int index : memoized)
+    {
+        state.WriteUInt32(index);
+    }
+    memoCache.Write(state, m_bodies);
+    uint64_t randomState[Random::StateSize];
+    random.GetState(randomState);
+    for (uint64_t part : randomState)
+    {
+        state.WriteUInt64(part);
+    }
+
+    // Bodies that haven't run yet are written in full, which they can't be if they don't parse
+    bool isValid = true;
+    for (TokenNode* body : m_bodies.GetBodies())
+    {
+        LazyBlockNode* lazyNode = dynamic_cast<LazyBlockNode*>(body);
+        if (lazyNode && !lazyNode->IsCompiled())
+        {
+            for (const Error& error : Parser::Compile(lazyNode))
+            {
+                std::cout << error.ToString() << '\n';
+            }
+        }
+        isValid = isValid && (lazyNode == NULL || lazyNode->GetBlock() != NULL);
+    }
+    if (!isValid)
+    {
+        return false;
+    }
+
+    AstWriter writer;
+    writer.WriteUInt32(SnapshotMagic);
+    writer.WriteUInt32(SnapshotVersion);
+    writer.WriteUInt32(m_bodies.GetBodies().size());
+    for (TokenNode* body : m_bodies.GetBodies())
+    {
+        writeBody(writer, body);
+    }
+    writer.WriteString(tables.GetData());
+    writer.WriteString(state.GetData());
+
+    // Write to a temporary file first so a reader never sees a partial image, and so processes saving
+    // the same snapshot don't write into each other's
+    std::string tempPath = SourceFile::GetTempPath(path);
+    std::ofstream file(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+    {
+        return false;
+    }
+    file.write(writer.GetData().data(), writer.GetData().size());
+    file.close();
+    std::error_code error;
+    if (file.fail())
+    {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    std::filesystem::rename(tempPath, path, error);
+    if (error)
+    {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    return true;
+}
+
+bool Snapshot::Restore(const std::string& path, SymbolTable& globalTable, MemoCache& memoCache,
+    std::unordered_set<const TokenNode*>& memoizedFunctions, Random& random)
+{
+    m_bodies = BodyTable();
+
+    const SourceFile* image = SourceFile::Load(path);
+    if (image == nullptr)
+    {
+        return false;
+    }
+
+    AstReader reader(image->GetText().data(), image->GetText().size());
+    if (reader.ReadUInt32() != SnapshotMagic || reader.ReadUInt32() != SnapshotVersion)
+    {
+        return false;
+    }
+
+    unsigned int bodyCount = reader.ReadUInt32();
+    for (unsigned int i = 0; i < bodyCount; i++)
+    {
+        if (!readBody(reader))
+        {
+            return false;
+        }
+    }
+
+    std::string_view tables = reader.ReadString();
+    std::string_view state = reader.ReadString();
+    if (reader.HasError() || !reader.AtEnd())
+    {
+        return false;
+    }
+    AstReader tableReader(tables.data(), tables.size());
+    if (!globalTable.Read(tableReader, m_bodies) || !tableReader.AtEnd())
+    {
+        return false;
+    }
+
+    AstReader stateReader(state.data(), state.size());
+    memoizedFunctions.clear();
+    unsigned int count = stateReader.ReadUInt32();
+    for (unsigned int i = 0; i < count && !stateReader.HasError(); i++)
+    {
+        TokenNode* body = m_bodies.Get(stateReader.ReadUInt32());
+        if (body == NULL)
+        {
+            return false;
+        }
+        memoizedFunctions.insert(body);
+    }
+    if (!memoCache.Read(stateReader, m_bodies))
+    {
+        return false;
+    }
+    uint64_t randomState[Random::StateSize];
+    for (uint64_t& part : randomState)
+    {
+        part = stateReader.ReadUInt64();
+    }
+    return !stateReader.HasError() && stateReader.AtEnd() && random.SetState(randomState);
+}
+
+void Snapshot::writeBody(AstWriter& writer, TokenNode* body)
+{
+    // Locations are kept relative to the body's source, so errors in it still have a line and column
+    std::string sourceName;
+    SourceLocation base = NoLocation;
+    size_t sourceSize = 0;
+    SourceMap::FindSource(FindLocation(body), sourceName, base, sourceSize);
+
+    AstWriter bodyWriter(base);
+    bodyWriter.WriteNode(body);
+
+    writer.WriteString(sourceName);
+    writer.WriteUInt64(sourceSize);
+    writer.WriteString(bodyWriter.GetData());
+}
+
+bool Snapshot::readBody(AstReader& reader)
+{
+    std::string_view sourceName = reader.ReadString();
+    unsigned long long sourceSize = reader.ReadUInt64();
+    std::string_view data = reader.ReadString();
+    if (reader.HasError())
+    {
+        return false;
+    }
+
+    AstReader bodyReader(data.data(), data.size());
+    if (!sourceName.empty())
+    {
+        // The source is only read if an error needs a line and column from it
+        bodyReader.SetBaseLocation(SourceMap::AddSource(std::string(sourceName), sourceSize));
+    }
+    TokenNode* body = bodyReader.ReadNode();
+    if (body == NULL || bodyReader.HasError() || !bodyReader.AtEnd())
+    {
+        return false;
+    }
+    m_bodies.Add(body);
+    return true;
+}
\ No newline at end of file
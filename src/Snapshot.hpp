@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class AstReader;
+class AstWriter;
+class MemoCache;
+class Random;
+class SymbolTable;
+class TokenNode;
+
+// Numbers the function bodies in a snapshot. Bodies are shared between objects, their instances and children,
+// so each is written once and referred to by its number.
+class BodyTable
+{
+public:
+    BodyTable();
+    ~BodyTable();
+
+    // Returns the body's number, giving it the next one if it's new
+    unsigned int Add(TokenNode* body);
+    // Returns false if the body hasn't been numbered
+    bool Find(const TokenNode* body, unsigned int& index) const;
+    // NULL if no body has that number
+    TokenNode* Get(unsigned int index) const;
+
+    const std::vector<TokenNode*>& GetBodies() const;
+
+private:
+    std::unordered_map<const TokenNode*, unsigned int> m_indices;
+    std::vector<TokenNode*> m_bodies;
+};
+
+// Image of the global symbol table, with its modules, objects and function bodies, taken after a
+// prelude has run. Restoring it lets a script start from that state without running the prelude again.
+// Memoized functions, their cached results and the random number generator are kept too.
+class Snapshot
+{
+public:
+    Snapshot();
+    ~Snapshot();
+
+    bool Save(const std::string& path, const SymbolTable& globalTable, const MemoCache& memoCache,
+        const std::unordered_set<const TokenNode*>& memoizedFunctions, const Random& random);
+    // The image is mapped and kept, since restored function bodies view into it.
+    // Returns false if it can't be read or is malformed, leaving the state partly filled.
+    bool Restore(const std::string& path, SymbolTable& globalTable, MemoCache& memoCache,
+        std::unordered_set<const TokenNode*>& memoizedFunctions, Random& random);
+
+private:
+    BodyTable m_bodies;
+
+    void writeBody(AstWriter& writer, TokenNode* body);
+    bool readBody(AstReader& reader);
+};
\ No newline at end of file
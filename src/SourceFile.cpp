@@ -0,0 +1,201 @@
+#include "SourceFile.hpp"
+
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <system_error>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static std::vector<std::unique_ptr<SourceFile>> s_keptFiles;
+static std::mutex s_keptFilesMutex;
+
+SourceFile::SourceFile(const std::string& name)
+    : m_name(name), m_buffer(""), m_data(nullptr), m_size(0), m_isMapped(false), m_baseLocation(NoLocation)
+{
+}
+
+SourceFile::~SourceFile()
+{
+#ifndef _WIN32
+    if (m_isMapped)
+    {
+        munmap((void*)m_data, m_size);
+    }
+#endif
+}
+
+void SourceFile::SetMappingEnabled(bool isEnabled)
+{
+    s_isMappingEnabled = isEnabled;
+}
+
+std::unique_ptr<SourceFile> SourceFile::Open(const std::string& path)
+{
+    std::unique_ptr<SourceFile> file(new SourceFile(path));
+    if (!file->map() && !file->read())
+    {
+        return nullptr;
+    }
+    return file;
+}
+
+std::unique_ptr<SourceFile> SourceFile::FromString(const std::string& name, std::string_view text)
+{
+    std::unique_ptr<SourceFile> file(new SourceFile(name));
+    file->m_buffer = std::string(text);
+    file->m_data = file->m_buffer.data();
+    file->m_size = file->m_buffer.size();
+    return file;
+}
+
+const SourceFile* SourceFile::Keep(std::unique_ptr<SourceFile> file)
+{
+    if (!file)
+    {
+        return nullptr;
+    }
+    std::lock_guard<std::mutex> lock(s_keptFilesMutex);
+    s_keptFiles.push_back(std::move(file));
+    return s_keptFiles.back().get();
+}
+
+const SourceFile* SourceFile::Load(const std::string& path)
+{
+    return Keep(Open(path));
+}
+
+std::string SourceFile::GetDirectory(const std::string& path)
+{
+    size_t separator = path.find_last_of('/');
+    if (separator == std::string::npos)
+    {
+        return ".";
+    }
+    else if (separator == 0)
+    {
+        return "/";
+    }
+    return path.substr(0, separator);
+}
+
+std::string SourceFile::ResolvePath(const std::string& directory, const std::string& path)
+{
+    return std::filesystem::path(directory + "/" + path).lexically_normal().generic_string();
+}
+
+std::string SourceFile::GetTempPath(const std::string& path)
+{
+#ifdef _WIN32
+    unsigned long processId = _getpid();
+#else
+    unsigned long processId = getpid();
+#endif
+    static std::atomic<unsigned int> s_count(0);
+    return path + "." + std::to_string(processId) + "." + std::to_string(s_count++) + ".tmp";
+}
+
+const std::string& SourceFile::GetName() const
+{
+    return m_name;
+}
+
+std::string_view SourceFile::GetText() const
+{
+    return std::string_view(m_data, m_size);
+}
+
+bool SourceFile::IsMapped() const
+{
+    return m_isMapped;
+}
+
+SourceLocation SourceFile::GetBaseLocation() const
+{
+    if (m_baseLocation == NoLocation)
+    {
+        m_baseLocation = SourceMap::AddSource(m_name, GetText());
+    }
+    return m_baseLocation;
+}
+
+bool SourceFile::map()
+{
+#ifndef _WIN32
+    if (!s_isMappingEnabled)
+    {
+        return false;
+    }
+
+    int fd = open(m_name.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || (size_t)info.st_size < MinMappedSize)
+    {
+        // Pipes and devices have no fixed size
+        close(fd);
+        return false;
+    }
+
+    void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+
+    m_data = (const char*)data;
+    m_size = info.st_size;
+    m_isMapped = true;
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool SourceFile::read()
+{
+    // A directory opens as a stream but fails on the first read
+    std::error_code error;
+    if (std::filesystem::is_directory(m_name, error))
+    {
+        return false;
+    }
+
+    std::ifstream file(m_name, std::ios::in | std::ios::binary);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    // The stream buffer throws on a read error rather than setting badbit
+    try
+    {
+        m_buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    catch (const std::ios_base::failure&)
+    {
+        return false;
+    }
+    if (file.bad())
+    {
+        return false;
+    }
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+    return true;
+}
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "SourceMap.hpp"
+
+// Read-only view of a script's text. Large files are memory mapped where possible, and the rest are
+// read into a buffer. Tokens view into the text, so anything that is lexed should be
+// handed to Keep (or loaded with Load) so it lives as long as the program.
+class SourceFile
+{
+public:
+    // Smaller files are read, since mapping costs more than reading them and a mapped file that is
+    // truncated while its tokens are still in use crashes the next access to them
+    static const size_t MinMappedSize = 1024 * 1024;
+
+    ~SourceFile();
+
+    // Off reads every file, for when sources are kept while the user may be editing them, as in the REPL.
+    // Set before anything is loaded.
+    static void SetMappingEnabled(bool isEnabled);
+
+    // Returns nullptr if the file can't be opened or is a directory. The caller owns the result.
+    static std::unique_ptr<SourceFile> Open(const std::string& path);
+    // Copies text that didn't come from a file, such as REPL input
+    static std::unique_ptr<SourceFile> FromString(const std::string& name, std::string_view text);
+
+    // Keeps the source alive until exit and returns it
+    static const SourceFile* Keep(std::unique_ptr<SourceFile> file);
+    // Open followed by Keep
+    static const SourceFile* Load(const std::string& path);
+
+    // The directory part of path, or "." if it has none
+    static std::string GetDirectory(const std::string& path);
+    // path joined onto directory and lexically normalized, so that however a file is reached it has one name
+    static std::string ResolvePath(const std::string& directory, const std::string& path);
+    // path with a suffix unique to this process and call, for writing a file that is then renamed over path
+    static std::string GetTempPath(const std::string& path);
+
+    const std::string& GetName() const;
+    std::string_view GetText() const;
+    bool IsMapped() const;
+    // The location of the first character, registering the source with the SourceMap on first use.
+    // Only kept sources should be registered.
+    SourceLocation GetBaseLocation() const;
+
+private:
+    SourceFile(const std::string& name);
+
+    std::string m_name;
+    std::string m_buffer;
+    const char* m_data;
+    size_t m_size;
+    bool m_isMapped;
+    mutable SourceLocation m_baseLocation;
+
+    static inline bool s_isMappingEnabled = true;
+
+    bool map();
+    bool read();
+};
\ No newline at end of file
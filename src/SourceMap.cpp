@@ -0,0 +1,115 @@
+#include "SourceMap.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <mutex>
+
+#include "SourceFile.hpp"
+
+// Files may be lexed on several threads at once
+static std::mutex s_sourcesMutex;
+
+std::vector<SourceMap::Source>& SourceMap::getSources()
+{
+    static std::vector<Source> s_sources;
+    return s_sources;
+}
+
+SourceLocation SourceMap::AddSource(const std::string& name, std::string_view text)
+{
+    return addSource({ name, NoLocation, text.size(), true, text, {} });
+}
+
+SourceLocation SourceMap::AddSource(const std::string& name, size_t size)
+{
+    return addSource({ name, NoLocation, size, false, std::string_view(), {} });
+}
+
+SourceLocation SourceMap::addSource(Source source)
+{
+    std::lock_guard<std::mutex> lock(s_sourcesMutex);
+    std::vector<Source>& sources = getSources();
+
+    // Location 0 means unknown, and each source has one extra location for its end
+    unsigned long long base = sources.empty() ? 1 : (unsigned long long)sources.back().base + sources.back().size + 1;
+    if (base + source.size + 1 > std::numeric_limits<SourceLocation>::max())
+    {
+        return NoLocation;
+    }
+
+    source.base = (SourceLocation)base;
+    sources.push_back(source);
+    return source.base;
+}
+
+Position SourceMap::Resolve(SourceLocation location)
+{
+    std::lock_guard<std::mutex> lock(s_sourcesMutex);
+    std::vector<Source>& sources = getSources();
+    auto it = std::upper_bound(sources.begin(), sources.end(), location, [](SourceLocation value, const Source& source)
+    {
+        return value < source.base;
+    });
+    if (location == NoLocation || it == sources.begin())
+    {
+        return Position("Unknown", 0, 0, 0);
+    }
+
+    Source& source = *(it - 1);
+    unsigned int offset = location - source.base;
+    if (offset > source.size)
+    {
+        return Position("Unknown", 0, 0, 0);
+    }
+
+    if (!source.hasText)
+    {
+        const SourceFile* file = SourceFile::Load(source.name);
+        if (file == nullptr || file->GetText().size() != source.size)
+        {
+            return Position(source.name, 0, 0, offset);
+        }
+        source.text = file->GetText();
+        source.hasText = true;
+    }
+    if (source.lineStarts.empty())
+    {
+        buildLineStarts(source);
+    }
+
+    // Lines start at 1 and columns at 0, as the lexer has always counted them
+    auto line = std::upper_bound(source.lineStarts.begin(), source.lineStarts.end(), offset);
+    unsigned int lineStart = *(line - 1);
+    return Position(source.name, line - source.lineStarts.begin(), offset - lineStart, offset);
+}
+
+bool SourceMap::FindSource(SourceLocation location, std::string& name, SourceLocation& base, size_t& size)
+{
+    std::lock_guard<std::mutex> lock(s_sourcesMutex);
+    std::vector<Source>& sources = getSources();
+    auto it = std::upper_bound(sources.begin(), sources.end(), location, [](SourceLocation value, const Source& source)
+    {
+        return value < source.base;
+    });
+    if (location == NoLocation || it == sources.begin() || location - (it - 1)->base > (it - 1)->size)
+    {
+        return false;
+    }
+
+    name = (it - 1)->name;
+    base = (it - 1)->base;
+    size = (it - 1)->size;
+    return true;
+}
+
+void SourceMap::buildLineStarts(Source& source)
+{
+    source.lineStarts.push_back(0);
+    for (size_t i = 0; i < source.text.size(); i++)
+    {
+        if (source.text[i] == '\n')
+        {
+            source.lineStarts.push_back(i + 1);
+        }
+    }
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Position.hpp"
+
+// An offset into one space shared by every source that has been lexed, so a token only needs
+// 32 bits to say where it came from. Lines and columns are worked out when an error is reported.
+typedef unsigned int SourceLocation;
+static const SourceLocation NoLocation = 0;
+
+// Sources can be added and resolved from any thread
+class SourceMap
+{
+public:
+    // Reserves locations for a source and returns the first one, or NoLocation if the space is full.
+    // The text must outlive the map.
+    static SourceLocation AddSource(const std::string& name, std::string_view text);
+    // For trees loaded without their source (cached modules). The file is only read if a location in it is resolved.
+    static SourceLocation AddSource(const std::string& name, size_t size);
+
+    static Position Resolve(SourceLocation location);
+    // Finds the source a location belongs to. Returns false if it isn't in any.
+    static bool FindSource(SourceLocation location, std::string& name, SourceLocation& base, size_t& size);
+
+private:
+    struct Source
+    {
+        std::string name;
+        SourceLocation base;
+        size_t size;
+        bool hasText;
+        std::string_view text;
+        std::vector<unsigned int> lineStarts;
+    };
+
+    static std::vector<Source>& getSources();
+    static SourceLocation addSource(Source source);
+    static void buildLineStarts(Source& source);
+};
\ No newline at end of file
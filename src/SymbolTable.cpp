@@ -4,6 +4,10 @@
 #include <cmath>
 #include <iostream>
 
+#include "AstSerializer.hpp"
+#include "Instrumentation.hpp"
+#include "MemoryTracker.hpp"
+#include "Snapshot.hpp"
 #include "TokenNode.hpp"
 
 SymbolTable::SymbolTable(const std::string& name, SymbolTable* parentScope)
@@ -20,11 +24,9 @@ SymbolTable::SymbolTable(const std::string& name, SymbolTable* parentScope)
         m_builtInFunctions["tostring"] = &SymbolTable::toString;
         m_builtInFunctions["tonumber"] = &SymbolTable::toNumber;
         m_builtInFunctions["sizeof"] = &SymbolTable::arraySize;
-        m_builtInFunctions["seed"] = &SymbolTable::seed;
         m_builtInFunctions["round"] = &SymbolTable::round;
         m_builtInFunctions["floor"] = &SymbolTable::floor;
         m_builtInFunctions["ceil"] = &SymbolTable::ceil;
-        m_builtInFunctions["random"] = &SymbolTable::random;
         m_builtInFunctions["abs"] = &SymbolTable::abs;
         m_builtInFunctions["sin"] = &SymbolTable::sin;
         m_builtInFunctions["cos"] = &SymbolTable::cos;
@@ -36,6 +38,7 @@ SymbolTable::SymbolTable(const std::string& name, SymbolTable* parentScope)
         m_builtInFunctions["sqrt"] = &SymbolTable::sqrt;
         m_builtInFunctions["log"] = &SymbolTable::log;
         m_builtInFunctions["log10"] = &SymbolTable::log10;
+        m_builtInFunctions["memstats"] = &SymbolTable::memStats;
     }
 }
 
@@ -44,8 +47,19 @@ SymbolTable::~SymbolTable()
     
 }
 
+void* SymbolTable::operator new(size_t size)
+{
+    return MemoryTracker::AllocateObject(MemoryTracker::Category::SymbolTable, size);
+}
+
+void SymbolTable::operator delete(void* pointer)
+{
+    MemoryTracker::FreeObject(MemoryTracker::Category::SymbolTable, pointer);
+}
+
 bool SymbolTable::VarExists(const std::string& varName, bool global) const
 {
+    PLANETOID_COUNT(VariableLookup);
     if (m_variables.find(varName) != m_variables.end())
     {
         return true;
@@ -59,6 +73,7 @@ bool SymbolTable::VarExists(const std::string& varName, bool global) const
 
 void SymbolTable::RegisterVar(const std::string& name, const Value& value)
 {
+    PLANETOID_COUNT(VariableLookup);
     if (m_variables.find(name) != m_variables.end())
     {
         m_variables[name] = value;
@@ -81,8 +96,14 @@ void SymbolTable::RegisterVar(const std::string& name, const Value& value)
     }
 }
 
+void SymbolTable::RegisterLocalVar(const std::string& name, const Value& value)
+{
+    m_variables[name] = value;
+}
+
 Value SymbolTable::GetVar(const std::string& name, bool global) const
 {
+    PLANETOID_COUNT(VariableLookup);
     if (m_variables.find(name) != m_variables.end())
     {
         return m_variables.at(name);
@@ -97,6 +118,7 @@ Value SymbolTable::GetVar(const std::string& name, bool global) const
 
 SymbolTable* SymbolTable::GetVarScope(const std::string& name) const
 {
+    PLANETOID_COUNT(VariableLookup);
     if (m_variables.find(name) != m_variables.end())
     {
         return const_cast<SymbolTable*>(this);
@@ -138,6 +160,7 @@ bool SymbolTable::IsBuiltInFunction(const std::string& name, bool forceParent) c
 
 bool SymbolTable::IsUserFunction(const std::string& name, bool global) const
 {
+    PLANETOID_COUNT(FunctionLookup);
     bool isFunction = false;
     if (m_parentScope != NULL && global)
     {
@@ -148,6 +171,7 @@ bool SymbolTable::IsUserFunction(const std::string& name, bool global) const
 
 SymbolTable* SymbolTable::GetUserFunctionScope(const std::string& name) const
 {
+    PLANETOID_COUNT(FunctionLookup);
     if (m_userFunctions.find(name) != m_userFunctions.end())
     {
         return const_cast<SymbolTable*>(this);
@@ -184,16 +208,17 @@ void SymbolTable::RegisterUserFunction(const std::string& name, TokenNode* body)
 
 TokenNode* SymbolTable::GetUserFunction(const std::string& name, bool global) const
 {
-    TokenNode* function = NULL;
-    if (m_parentScope != NULL && global)
+    PLANETOID_COUNT(FunctionLookup);
+    if (m_userFunctions.find(name) != m_userFunctions.end())
     {
-        function = m_parentScope->GetUserFunction(name);
+        return m_userFunctions.at(name);
     }
-    if (function == NULL)
+    else if (m_parentScope != NULL && global)
     {
-        function = m_userFunctions.at(name);
+        return m_parentScope->GetUserFunction(name, true);
     }
-    return function;
+
+    return NULL;
 }
 
 bool SymbolTable::RegisterObject(const std::string& name, const std::string& parentName)
@@ -453,6 +478,7 @@ SymbolTable* SymbolTable::GetParentScope() const
 
 void SymbolTable::AddScope(const std::string& name)
 {
+    PLANETOID_COUNT(ScopeAdded);
     m_scopes[name] = new SymbolTable(name, this);
 }
 
@@ -463,6 +489,9 @@ SymbolTable* SymbolTable::GetScope(const std::string& name) const
 
 void SymbolTable::RemoveScope(const std::string& name)
 {
+    PLANETOID_COUNT(ScopeRemoved);
+    // Object instances made in the scope live in scopes of their own beneath it
+    m_scopes.at(name)->CleanUp();
     delete m_scopes.at(name);
     m_scopes.erase(name);
 }
@@ -498,11 +527,122 @@ void SymbolTable::CleanUp()
     m_modules.clear();
 }
 
+void SymbolTable::Write(AstWriter& writer, BodyTable& bodies) const
+{
+    writer.WriteString(m_name);
+
+    writer.WriteUInt32(m_variables.size());
+    for (const auto& var : m_variables)
+    {
+        writer.WriteString(var.first);
+        writer.WriteValue(var.second);
+    }
+
+    writer.WriteUInt32(m_userFunctions.size());
+    for (const auto& func : m_userFunctions)
+    {
+        writer.WriteString(func.first);
+        writer.WriteUInt32(bodies.Add(func.second));
+    }
+
+    writer.WriteUInt32(m_objectNames.size());
+    for (const auto& object : m_objectNames)
+    {
+        writer.WriteString(object.first);
+        writer.WriteString(object.second);
+    }
+
+    writer.WriteUInt32(m_objectInstanceNames.size());
+    for (const auto& instance : m_objectInstanceNames)
+    {
+        writer.WriteString(instance.first);
+        writer.WriteString(instance.second);
+    }
+
+    writer.WriteUInt32(m_scopes.size());
+    for (const auto& scope : m_scopes)
+    {
+        writer.WriteString(scope.first);
+        scope.second->Write(writer, bodies);
+    }
+
+    writer.WriteUInt32(m_modules.size());
+    for (const auto& module : m_modules)
+    {
+        writer.WriteString(module.first);
+        module.second->Write(writer, bodies);
+    }
+}
+
+bool SymbolTable::Read(AstReader& reader, const BodyTable& bodies)
+{
+    m_name = std::string(reader.ReadString());
+
+    unsigned int count = reader.ReadUInt32();
+    for (unsigned int i = 0; i < count && !reader.HasError(); i++)
+    {
+        std::string name(reader.ReadString());
+        m_variables[name] = reader.ReadValue();
+    }
+
+    count = reader.ReadUInt32();
+    for (unsigned int i = 0; i < count && !reader.HasError(); i++)
+    {
+        std::string name(reader.ReadString());
+        TokenNode* body = bodies.Get(reader.ReadUInt32());
+        if (body == NULL)
+        {
+            return false;
+        }
+        m_userFunctions[name] = body;
+    }
+
+    count = reader.ReadUInt32();
+    for (unsigned int i = 0; i < count && !reader.HasError(); i++)
+    {
+        std::string name(reader.ReadString());
+        m_objectNames[name] = std::string(reader.ReadString());
+    }
+
+    count = reader.ReadUInt32();
+    for (unsigned int i = 0; i < count && !reader.HasError(); i++)
+    {
+        std::string name(reader.ReadString());
+        m_objectInstanceNames[name] = std::string(reader.ReadString());
+    }
+
+    count = reader.ReadUInt32();
+    for (unsigned int i = 0; i < count && !reader.HasError(); i++)
+    {
+        std::string name(reader.ReadString());
+        SymbolTable* scope = new SymbolTable(name, this);
+        m_scopes[name] = scope;
+        if (!scope->Read(reader, bodies))
+        {
+            return false;
+        }
+    }
+
+    count = reader.ReadUInt32();
+    for (unsigned int i = 0; i < count && !reader.HasError(); i++)
+    {
+        std::string name(reader.ReadString());
+        SymbolTable* module = new SymbolTable(name, this);
+        m_modules[name] = module;
+        if (!module->Read(reader, bodies))
+        {
+            return false;
+        }
+    }
+
+    return !reader.HasError();
+}
+
 Value SymbolTable::Print(const std::vector<Value>& args)
 {
     for (auto& arg : args)
     {
-        std::cout << arg.toString();
+        arg.write(std::cout);
     }
     std::cout << '\n';
 
@@ -544,9 +684,11 @@ Value SymbolTable::input(const std::vector<Value>& args)
     {
         for (auto& arg : args)
         {
-            std::cout << arg.toString();
+            arg.write(std::cout);
         }
     }
+    // The prompt has to be seen before waiting for the answer
+    std::cout.flush();
 
     std::string input;
     std::getline(std::cin, input);
@@ -602,15 +744,6 @@ Value SymbolTable::arraySize(const std::vector<Value>& args)
     }
 }
 
-Value SymbolTable::seed(const std::vector<Value>& args)
-{
-    if (args.size() == 1)
-        srand(args[0].getNumber());
-    else if (args.size() == 0)
-        srand(time(NULL));
-    return Value();
-}
-
 Value SymbolTable::round(const std::vector<Value>& args)
 {
     if (args.size() != 1 || !args[0].isNumber())
@@ -641,16 +774,6 @@ Value SymbolTable::ceil(const std::vector<Value>& args)
     return Value(std::ceil(args[0].getNumber()));
 }
 
-Value SymbolTable::random(const std::vector<Value>& args)
-{
-    if (args.size() != 2 || !args[0].isNumber() || !args[1].isNumber())
-    {
-        return Value();
-    }
-
-    return Value(float(rand()) / RAND_MAX * (args[1].getNumber() - args[0].getNumber()) + args[0].getNumber());
-}
-
 Value SymbolTable::abs(const std::vector<Value>& args)
 {
     if (args.size() != 1 || !args[0].isNumber())
@@ -759,4 +882,20 @@ Value SymbolTable::log10(const std::vector<Value>& args)
     }
 
     return Value(std::log10(args[0].getNumber()));
+}
+
+Value SymbolTable::memStats(const std::vector<Value>& args)
+{
+    if (args.size() != 0 || !MemoryTracker::IsEnabled())
+    {
+        return Value();
+    }
+
+    std::vector<Value> stats;
+    for (const MemoryTracker::Stats& category : MemoryTracker::GetStats())
+    {
+        stats.push_back(std::vector<Value>{ Value(std::string(category.name)), Value((float)category.liveBytes),
+            Value((float)category.peakBytes), Value((float)category.allocations) });
+    }
+    return stats;
 }
\ No newline at end of file
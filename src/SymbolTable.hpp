@@ -6,6 +6,9 @@
 
 #include "Value.hpp"
 
+class AstReader;
+class AstWriter;
+class BodyTable;
 class TokenNode;
 class SymbolTable
 {
@@ -13,8 +16,13 @@ public:
     SymbolTable(const std::string& name, SymbolTable* parentScope);
     ~SymbolTable();
 
+    // Counted by MemoryTracker
+    static void* operator new(size_t size);
+    static void operator delete(void* pointer);
+
     bool VarExists(const std::string& varName, bool global = false) const;
     void RegisterVar(const std::string& name, const Value& value);
+    void RegisterLocalVar(const std::string& name, const Value& value);
     Value GetVar(const std::string& name, bool global = false) const;
     SymbolTable* GetVarScope(const std::string& name) const;
     void DestroyVar(const std::string& name);
@@ -57,6 +65,10 @@ public:
 
     void CleanUp();
 
+    // Records the table with its scopes and modules for a snapshot, numbering function bodies in bodies
+    void Write(AstWriter& writer, BodyTable& bodies) const;
+    // Fills an empty table from what Write recorded. Returns false if it's malformed.
+    bool Read(AstReader& reader, const BodyTable& bodies);
 
 protected:
     std::unordered_map<std::string, Value> m_variables;
@@ -84,11 +96,9 @@ private:
     Value toString(const std::vector<Value>& args);
     Value toNumber(const std::vector<Value>& args);
     Value arraySize(const std::vector<Value>& args);
-    Value seed(const std::vector<Value>& args);
     Value round(const std::vector<Value>& args);
     Value floor(const std::vector<Value>& args);
     Value ceil(const std::vector<Value>& args);
-    Value random(const std::vector<Value>& args);
     Value abs(const std::vector<Value>& args);
     Value sin(const std::vector<Value>& args);
     Value cos(const std::vector<Value>& args);
@@ -100,6 +110,7 @@ private:
     Value sqrt(const std::vector<Value>& args);
     Value log(const std::vector<Value>& args);
     Value log10(const std::vector<Value>& args);
+    Value memStats(const std::vector<Value>& args);
 };
 
 static SymbolTable g_symbolTable("Global", NULL);
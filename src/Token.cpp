@@ -1,22 +1,40 @@
 #include "Token.hpp"
 
-Token::Token(Type type, const std::string& value)
-    : m_type(type), m_value(value)
+#include <mutex>
+#include <unordered_set>
+
+#include "MemoryTracker.hpp"
+
+static std::string_view Intern(const std::string& value)
 {
+    static std::unordered_set<std::string> s_values;
+    static std::mutex s_valuesMutex;
+    std::lock_guard<std::mutex> lock(s_valuesMutex);
+    auto inserted = s_values.insert(value);
+    if (inserted.second && MemoryTracker::IsEnabled())
+    {
+        MemoryTracker::Allocate(MemoryTracker::Category::Token, sizeof(std::string) + value.size() + 1);
+    }
+    return *inserted.first;
 }
 
-Token::~Token()
+Token::Token(Type type, std::string_view value, SourceLocation location)
+    : m_type(type), m_location(location), m_value(value)
 {
 }
 
-Token::Type Token::GetType() const
+Token::Token(Type type, const char* value, SourceLocation location)
+    : m_type(type), m_location(location), m_value(value)
 {
-    return m_type;
 }
 
-const std::string& Token::GetValue() const
+Token::Token(Type type, const std::string& value, SourceLocation location)
+    : m_type(type), m_location(location), m_value(Intern(value))
+{
+}
+
+Token::~Token()
 {
-    return m_value;
 }
 
 std::string Token::ToString() const
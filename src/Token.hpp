@@ -1,6 +1,9 @@
 #pragma once
 
 #include <string>
+#include <string_view>
+
+#include "SourceMap.hpp"
 
 class Token
 {
@@ -44,15 +47,21 @@ public:
     };
 private:
 public:
-    Token(Type type, const std::string& value);
+    // The value is a view, so it must outlive the token (source text or a literal)
+    Token(Type type, std::string_view value, SourceLocation location = NoLocation);
+    Token(Type type, const char* value, SourceLocation location = NoLocation);
+    // Values built at runtime are interned so the view stays valid
+    Token(Type type, const std::string& value, SourceLocation location = NoLocation);
     ~Token();
 
-    Type GetType() const;
-    const std::string& GetValue() const;
+    Type GetType() const { return m_type; }
+    std::string_view GetValue() const { return m_value; }
+    SourceLocation GetLocation() const { return m_location; }
 
     std::string ToString() const;
 
 private:
     Type m_type;
-    std::string m_value;
+    SourceLocation m_location;
+    std::string_view m_value;
 };
\ No newline at end of file
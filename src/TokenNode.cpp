@@ -1,10 +1,22 @@
 #include "TokenNode.hpp"
 
+#include "MemoryTracker.hpp"
+
 TokenNode::TokenNode(Token token, NodeType type)
     : m_token(token), m_type(type)
 {
 }
 
+void* TokenNode::operator new(size_t size)
+{
+    return MemoryTracker::AllocateObject(MemoryTracker::Category::Ast, size);
+}
+
+void TokenNode::operator delete(void* pointer)
+{
+    MemoryTracker::FreeObject(MemoryTracker::Category::Ast, pointer);
+}
+
 ArrayNode::ArrayNode(Token token, std::vector<TokenNode*> array)
     : TokenNode(token, NodeType::Array), m_array(array)
 {
@@ -110,7 +122,7 @@ SequenceNode::SequenceNode(Token token, std::vector<TokenNode*> nodes)
 {
 }
 
-std::vector<TokenNode*> SequenceNode::GetNodes() const
+const std::vector<TokenNode*>& SequenceNode::GetNodes() const
 {
     return m_nodes;
 }
@@ -283,4 +295,40 @@ TokenNode* ObjectDefinitionNode::GetParent() const
 ImportNode::ImportNode(Token token)
     : TokenNode(token, NodeType::Import)
 {
+}
+
+LazyBlockNode::LazyBlockNode(Token token, const SourceFile* source, size_t start, size_t end)
+    : TokenNode(token, NodeType::LazyBlock), m_source(source), m_start(start), m_end(end), m_isCompiled(false), m_block(NULL)
+{
+}
+
+const SourceFile* LazyBlockNode::GetSource() const
+{
+    return m_source;
+}
+
+size_t LazyBlockNode::GetStart() const
+{
+    return m_start;
+}
+
+size_t LazyBlockNode::GetEnd() const
+{
+    return m_end;
+}
+
+bool LazyBlockNode::IsCompiled() const
+{
+    return m_isCompiled;
+}
+
+TokenNode* LazyBlockNode::GetBlock() const
+{
+    return m_block;
+}
+
+void LazyBlockNode::SetBlock(TokenNode* block)
+{
+    m_block = block;
+    m_isCompiled = true;
 }
\ No newline at end of file
@@ -28,17 +28,25 @@ enum class NodeType
     FunctionDefinition,
     ObjectDefinition,
     ObjectAssign,
-    Import
+    Import,
+    LazyBlock // function body that hasn't been parsed yet
 };
 
+class SourceFile;
+
 class TokenNode
 {
 public:
     TokenNode(Token token, NodeType type = NodeType::Number);
     virtual ~TokenNode() = default;
 
+    // Counted by MemoryTracker
+    static void* operator new(size_t size);
+    static void operator delete(void* pointer);
+
     Token GetToken() const { return m_token; }
     NodeType GetType() const { return m_type; }
+    SourceLocation GetLocation() const { return m_token.GetLocation(); }
 protected:
     Token m_token;
     NodeType m_type;
@@ -139,7 +147,7 @@ public:
     SequenceNode(Token token, std::vector<TokenNode*> nodes);
     virtual ~SequenceNode() = default;
 
-    std::vector<TokenNode*> GetNodes() const;
+    const std::vector<TokenNode*>& GetNodes() const;
     void AddNode(TokenNode* node);
 private:
     std::vector<TokenNode*> m_nodes;
@@ -285,4 +293,28 @@ class ImportNode : public TokenNode
 public:
     ImportNode(Token token);
     virtual ~ImportNode() = default;
+};
+
+// A function body that is only parsed when the function is first called. It covers the source
+// between the body's braces, and keeps its identity once compiled so calls and caches can key on it.
+class LazyBlockNode : public TokenNode
+{
+public:
+    LazyBlockNode(Token token, const SourceFile* source, size_t start, size_t end);
+    virtual ~LazyBlockNode() = default;
+
+    const SourceFile* GetSource() const;
+    size_t GetStart() const;
+    size_t GetEnd() const;
+
+    bool IsCompiled() const;
+    // NULL until compiled, or if the body has a syntax error
+    TokenNode* GetBlock() const;
+    void SetBlock(TokenNode* block);
+private:
+    const SourceFile* m_source;
+    size_t m_start;
+    size_t m_end;
+    bool m_isCompiled;
+    TokenNode* m_block;
 };
\ No newline at end of file
@@ -0,0 +1,113 @@
+#include "Tracer.hpp"
+
+#include <fstream>
+#include <iomanip>
+#include <unordered_map>
+
+static const char* const s_categoryNames[] = { "function", "import", "object", "instance", "loop" };
+
+// Writes text as a JSON string, quotes included
+static void WriteJsonString(std::ostream& stream, std::string_view text)
+{
+    stream << '"';
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            stream << '\\' << c;
+        }
+        else if ((unsigned char)c < 0x20)
+        {
+            stream << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c << std::dec << std::setfill(' ');
+        }
+        else
+        {
+            stream << c;
+        }
+    }
+    stream << '"';
+}
+
+Tracer::Tracer(size_t maxEvents)
+    : m_start(std::chrono::steady_clock::now()), m_maxEvents(maxEvents), m_openCount(0), m_droppedCount(0)
+{
+}
+
+Tracer::~Tracer()
+{
+}
+
+bool Tracer::Begin(Category category, std::string_view name, SourceLocation location)
+{
+    // Leaves room for the end of this event and of every one still open
+    if (m_events.size() + m_openCount + 2 > m_maxEvents)
+    {
+        m_droppedCount++;
+        return false;
+    }
+    m_openCount++;
+    m_events.push_back({ now(), name, location, category, true });
+    return true;
+}
+
+void Tracer::End()
+{
+    m_openCount--;
+    m_events.push_back({ now(), std::string_view(), NoLocation, Category::Function, false });
+}
+
+bool Tracer::Write(const std::string& path) const
+{
+    std::ofstream file(path, std::ios::out | std::ios::trunc);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    // Many events share a line, which only needs looking up once
+    std::unordered_map<SourceLocation, std::string> lines;
+
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file << std::fixed << std::setprecision(3);
+    for (size_t i = 0; i < m_events.size(); i++)
+    {
+        const Event& event = m_events[i];
+        file << "{\"ph\":\"" << (event.isBegin ? 'B' : 'E') << "\",\"pid\":1,\"tid\":1,\"ts\":" << event.nanoseconds / 1000.0;
+        if (event.isBegin)
+        {
+            file << ",\"cat\":\"" << s_categoryNames[(int)event.category] << "\",\"name\":";
+            WriteJsonString(file, event.name);
+            if (event.location != NoLocation)
+            {
+                auto line = lines.find(event.location);
+                if (line == lines.end())
+                {
+                    Position position = SourceMap::Resolve(event.location);
+                    line = lines.emplace(event.location, position.GetFileName() + ":" + std::to_string(position.GetLine())).first;
+                }
+                file << ",\"args\":{\"source\":";
+                WriteJsonString(file, line->second);
+                file << '}';
+            }
+        }
+        file << '}' << (i + 1 < m_events.size() ? ",\n" : "\n");
+    }
+    file << "]}\n";
+    file.close();
+    return !file.fail();
+}
+
+size_t Tracer::GetEventCount() const
+{
+    return m_events.size();
+}
+
+size_t Tracer::GetDroppedCount() const
+{
+    return m_droppedCount;
+}
+
+long long Tracer::now() const
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count();
+}
\ No newline at end of file
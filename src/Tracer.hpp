@@ -0,0 +1,75 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "SourceMap.hpp"
+
+// Records when user function calls, imports, object definitions and instances, and loops begin and end,
+// and writes them in the Chrome trace event format for about:tracing or Perfetto. Events are kept in
+// memory until the trace is written. Names view into the script's tokens, which outlive the trace.
+class Tracer
+{
+public:
+    enum class Category
+    {
+        Function,
+        Import,
+        Object,
+        Instance,
+        Loop
+    };
+
+    // Begins an event when made and ends it when destroyed. Does nothing without a tracer.
+    class Scope
+    {
+    public:
+        Scope(Tracer* tracer, Category category, std::string_view name, SourceLocation location)
+            : m_tracer(tracer), m_isRecorded(tracer != nullptr && tracer->Begin(category, name, location))
+        {
+        }
+        ~Scope()
+        {
+            if (m_isRecorded)
+            {
+                m_tracer->End();
+            }
+        }
+
+    private:
+        Tracer* m_tracer;
+        bool m_isRecorded;
+    };
+
+    // Once maxEvents have been recorded, new events are dropped, though ones already begun still end
+    Tracer(size_t maxEvents = 4000000);
+    ~Tracer();
+
+    // Returns false if the event was dropped
+    bool Begin(Category category, std::string_view name, SourceLocation location);
+    void End();
+
+    bool Write(const std::string& path) const;
+    size_t GetEventCount() const;
+    size_t GetDroppedCount() const;
+
+private:
+    struct Event
+    {
+        long long nanoseconds;
+        std::string_view name;
+        SourceLocation location;
+        Category category;
+        bool isBegin;
+    };
+
+    std::chrono::steady_clock::time_point m_start;
+    std::vector<Event> m_events;
+    size_t m_maxEvents;
+    size_t m_openCount;
+    size_t m_droppedCount;
+
+    long long now() const;
+};
\ No newline at end of file
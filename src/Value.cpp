@@ -1,6 +1,58 @@
 #include "Value.hpp"
 
+#include <charconv>
 #include <cmath>
+#include <ostream>
+
+#include "Instrumentation.hpp"
+#include "MemoryTracker.hpp"
+
+// Contents are never changed in place, so what a value frees is what it allocated.
+// Moving leaves nothing behind to free, so moves aren't counted at all.
+static size_t StringBytes(const std::string& value)
+{
+    static const size_t inlineCapacity = std::string().capacity();
+    return value.capacity() > inlineCapacity ? value.capacity() + 1 : 0;
+}
+
+static size_t ArrayBytes(const std::vector<Value>& value)
+{
+    return value.capacity() * sizeof(Value);
+}
+
+static void TrackString(const std::string& value)
+{
+    if (MemoryTracker::IsEnabled() && StringBytes(value) != 0)
+    {
+        MemoryTracker::Allocate(MemoryTracker::Category::ValueString, StringBytes(value));
+    }
+}
+
+static void TrackArray(const std::vector<Value>& value)
+{
+    if (MemoryTracker::IsEnabled() && ArrayBytes(value) != 0)
+    {
+        MemoryTracker::Allocate(MemoryTracker::Category::ValueArray, ArrayBytes(value));
+    }
+}
+
+// Enough for the largest float with six decimals
+static const size_t MaxNumberLength = 64;
+
+// Whole numbers as integers, the rest with six decimals, the same as std::to_string without the allocation
+static size_t FormatNumber(float number, char* buffer)
+{
+    std::to_chars_result result;
+    if (number == std::floor(number))
+    {
+        result = std::to_chars(buffer, buffer + MaxNumberLength, (int)number);
+    }
+    else
+    {
+        result = std::to_chars(buffer, buffer + MaxNumberLength, number, std::chars_format::fixed, 6);
+    }
+    return result.ptr - buffer;
+}
 
 Value::Value()
     : m_number(0.0f), m_type(Type::Null)
@@ -10,17 +62,22 @@ Value::Value()
 Value::Value(const Value& other)
     : m_type(other.m_type)
 {
+    PLANETOID_COUNT(ValueCopy);
     if (m_type == Type::Number)
     {
         m_number = other.m_number;
     }
     else if (m_type == Type::String || m_type == Type::ObjectPointer)
     {
+        PLANETOID_COUNT(ValueStringAllocation);
         new (&m_string) std::string(other.m_string);
+        TrackString(m_string);
     }
     else if (m_type == Type::Array)
     {
+        PLANETOID_COUNT(ValueArrayAllocation);
         new (&m_array) std::vector<Value>(other.m_array);
+        TrackArray(m_array);
     }
 }
 
@@ -32,6 +89,8 @@ Value::Value(float value)
 Value::Value(const std::string& value, bool isString)
     : m_string(value)
 {
+    PLANETOID_COUNT(ValueStringAllocation);
+    TrackString(m_string);
     if (isString)
     {
         m_type = Type::String;
@@ -45,14 +104,81 @@ Value::Value(const std::string& value, bool isString)
 Value::Value(const std::vector<Value>& value)
     : m_array(value), m_type(Type::Array)
 {
+    PLANETOID_COUNT(ValueArrayAllocation);
+    TrackArray(m_array);
+}
+
+Value::Value(std::vector<Value>&& value)
+    : m_array(std::move(value)), m_type(Type::Array)
+{
+    TrackArray(m_array);
+}
+
+Value::Value(Value&& other) noexcept
+    : m_type(other.m_type)
+{
+    PLANETOID_COUNT(ValueMove);
+    if (m_type == Type::Number)
+    {
+        m_number = other.m_number;
+    }
+    else if (m_type == Type::String || m_type == Type::ObjectPointer)
+    {
+        new (&m_string) std::string(std::move(other.m_string));
+    }
+    else if (m_type == Type::Array)
+    {
+        new (&m_array) std::vector<Value>(std::move(other.m_array));
+    }
 }
 
 Value::~Value()
 {
+    destroy();
+}
+
+void Value::destroy()
+{
+    if (m_type == Type::String || m_type == Type::ObjectPointer)
+    {
+        if (MemoryTracker::IsEnabled() && StringBytes(m_string) != 0)
+        {
+            MemoryTracker::Free(MemoryTracker::Category::ValueString, StringBytes(m_string));
+        }
+        m_string.~basic_string();
+    }
+    else if (m_type == Type::Array)
+    {
+        if (MemoryTracker::IsEnabled() && ArrayBytes(m_array) != 0)
+        {
+            MemoryTracker::Free(MemoryTracker::Category::ValueArray, ArrayBytes(m_array));
+        }
+        m_array.~vector();
+    }
+    m_type = Type::Null;
 }
 
 void Value::operator=(const Value& other)
 {
+    if (this == &other)
+    {
+        return;
+    }
+
+    // Copy first, other may live inside this value's array
+    Value copy(other);
+    *this = std::move(copy);
+}
+
+void Value::operator=(Value&& other) noexcept
+{
+    if (this == &other)
+    {
+        return;
+    }
+    PLANETOID_COUNT(ValueMove);
+
+    destroy();
     m_type = other.m_type;
 
     if (m_type == Type::Number)
@@ -61,30 +187,39 @@ void Value::operator=(const Value& other)
     }
     else if (m_type == Type::String || m_type == Type::ObjectPointer)
     {
-        new (&m_string) std::string(other.m_string);
+        new (&m_string) std::string(std::move(other.m_string));
     }
     else if (m_type == Type::Array)
     {
-        new (&m_array) std::vector<Value>(other.m_array);
+        new (&m_array) std::vector<Value>(std::move(other.m_array));
     }
 }
 
 void Value::operator=(float value)
 {
+    destroy();
     m_type = Type::Number;
     m_number = value;
 }
 
 void Value::operator=(const std::string& value)
 {
+    PLANETOID_COUNT(ValueStringAllocation);
+    std::string copy(value);
+    destroy();
     m_type = Type::String;
-    new (&m_string) std::string(value);
+    new (&m_string) std::string(std::move(copy));
+    TrackString(m_string);
 }
 
 void Value::operator=(const std::vector<Value>& value)
 {
+    PLANETOID_COUNT(ValueArrayAllocation);
+    std::vector<Value> copy(value);
+    destroy();
     m_type = Type::Array;
-    new (&m_array) std::vector<Value>(value);
+    new (&m_array) std::vector<Value>(std::move(copy));
+    TrackArray(m_array);
 }
 
 Value Value::operator+(const Value& other) const
@@ -469,14 +604,8 @@ std::string Value::toString() const
 {
     if (m_type == Type::Number)
     {
-        if (m_number == std::floor(m_number))
-        {
-            return std::to_string((int)m_number);
-        }
-        else
-        {
-            return std::to_string(m_number);
-        }
+        char buffer[MaxNumberLength];
+        return std::string(buffer, FormatNumber(m_number, buffer));
     }
     else if (m_type == Type::String || m_type == Type::ObjectPointer)
     {
@@ -502,6 +631,36 @@ std::string Value::toString() const
     }
 }
 
+void Value::write(std::ostream& stream) const
+{
+    if (m_type == Type::Number)
+    {
+        char buffer[MaxNumberLength];
+        stream.write(buffer, FormatNumber(m_number, buffer));
+    }
+    else if (m_type == Type::String || m_type == Type::ObjectPointer)
+    {
+        stream.write(m_string.data(), m_string.size());
+    }
+    else if (m_type == Type::Array)
+    {
+        stream.put('[');
+        for (size_t i = 0; i < m_array.size(); i++)
+        {
+            if (i != 0)
+            {
+                stream.write(", ", 2);
+            }
+            m_array[i].write(stream);
+        }
+        stream.put(']');
+    }
+    else
+    {
+        stream.write("NULL", 4);
+    }
+}
+
 size_t Value::size() const
 {
     if (m_type == Type::Array)
@@ -520,4 +679,14 @@ size_t Value::size() const
     {
         return 0;
     }
+}
+
+Value& Value::operator[](size_t index)
+{
+    return m_array[index];
+}
+
+const Value& Value::operator[](size_t index) const
+{
+    return m_array[index];
 }
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <iosfwd>
 #include <string>
 #include <vector>
 
@@ -10,15 +11,18 @@ public:
     ~Value();
 
     Value(const Value& other);
+    Value(Value&& other) noexcept;
     Value(float value);
     Value(const std::string& value, bool isString = true);
     Value(const std::vector<Value>& value);
+    Value(std::vector<Value>&& value);
 
     float getNumber() const { return m_number; }
     std::string getString() const { return m_string; }
     std::vector<Value> getArray() const { return m_array; }
 
     void operator=(const Value& other);
+    void operator=(Value&& other) noexcept;
     void operator=(float value);
     void operator=(const std::string& value);
     void operator=(const std::vector<Value>& value);
@@ -76,8 +80,12 @@ public:
     const Value& operator[](size_t index) const;
 
     std::string toString() const;
+    // Writes what toString returns without building the string
+    void write(std::ostream& stream) const;
 
 private:
+    void destroy();
+
     enum class Type
     {
         Number,
@@ -0,0 +1,310 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "AstSerializer.hpp"
+#include "Error.hpp"
+#include "Interpreter.hpp"
+#include "Lexer.hpp"
+#include "ModuleCache.hpp"
+#include "Parser.hpp"
+#include "SourceFile.hpp"
+
+// Runs every script under each of the ways the interpreter can execute it and checks that they all print
+// exactly what the first, reference tier prints. Also reports how long each tier takes relative to the reference.
+
+// A new engine or optimization level gets a tier here, so it is held to the same output
+struct Tier
+{
+    const char* name;
+    // Function bodies parsed the first time they're called rather than up front
+    bool lazyFunctions;
+    ModuleCache::Mode cacheMode;
+    // Threads loading imported modules, 0 for one per core
+    unsigned int threadCount;
+    // The script's tree is written to its binary form and read back, the way cached modules are loaded
+    bool readsTree;
+};
+
+static const Tier s_tiers[] =
+{
+    { "eager", false, ModuleCache::Mode::Rebuild, 1, false },
+    { "lazy", true, ModuleCache::Mode::Disabled, 0, false },
+    { "serialized", false, ModuleCache::Mode::Enabled, 0, true }
+};
+
+struct Run
+{
+    std::string output;
+    double seconds;
+};
+
+static void FindScripts(const std::string& path, std::vector<std::string>& paths)
+{
+    std::error_code error;
+    if (!std::filesystem::is_directory(path, error))
+    {
+        paths.push_back(path);
+        return;
+    }
+
+    // Only the top level, so subdirectories can hold the modules scripts import
+    std::vector<std::string> found;
+    for (std::filesystem::directory_iterator it(path, error), end; !error && it != end; it.increment(error))
+    {
+        if (it->is_regular_file(error) && it->path().extension() == ".txt")
+        {
+            found.push_back(it->path().string());
+        }
+    }
+    std::sort(found.begin(), found.end());
+    paths.insert(paths.end(), found.begin(), found.end());
+}
+
+// Tokens in a tree read back view into the data, so it is kept until the script's runs are done
+static std::string WriteTree(const SourceFile* source)
+{
+    Lexer lexer(source);
+    Parser parser(lexer);
+    TokenNode* node = parser.Parse();
+    if (node == NULL)
+    {
+        return "";
+    }
+    AstWriter writer(source->GetBaseLocation());
+    writer.WriteNode(node);
+    return writer.GetData();
+}
+
+static Run RunScript(Interpreter& interpreter, const SourceFile* source, const Tier& tier, const std::string& tree)
+{
+    interpreter.GetModuleCache().SetMode(tier.cacheMode);
+    interpreter.GetModulePreloader().SetThreadCount(tier.threadCount);
+    interpreter.SetCurrentDirectory(source->GetName());
+
+    std::ostringstream output;
+    std::streambuf* consoleBuffer = std::cout.rdbuf(output.rdbuf());
+    auto start = std::chrono::steady_clock::now();
+
+    TokenNode* node = NULL;
+    if (tier.readsTree)
+    {
+        AstReader reader(tree.data(), tree.size());
+        reader.SetBaseLocation(source->GetBaseLocation());
+        node = reader.ReadNode();
+        if (node == NULL)
+        {
+            std::cout << "Failed to read the tree back.\n";
+        }
+    }
+    else
+    {
+        Lexer lexer(source);
+        Parser parser(lexer);
+        parser.SetLazyFunctions(tier.lazyFunctions);
+        node = parser.Parse();
+        for (const Error& error : parser.GetErrors())
+        {
+            std::cout << error.ToString() << '\n';
+        }
+    }
+
+    if (node)
+    {
+        interpreter.PreloadModules(node);
+        interpreter.Interpret(node);
+    }
+    // Part of the result, since whether a script stopped early isn't always visible in what it printed
+    if (interpreter.GetState().hasError)
+    {
+        std::cout << "[stopped by an error]\n";
+    }
+    interpreter.Reset();
+
+    auto end = std::chrono::steady_clock::now();
+    std::cout.rdbuf(consoleBuffer);
+    return { output.str(), std::chrono::duration<double>(end - start).count() };
+}
+
+// Prints the first line where the output differs from the reference
+static void PrintDifference(const std::string& expected, const std::string& actual, const char* referenceName, const char* tierName)
+{
+    std::istringstream expectedStream(expected);
+    std::istringstream actualStream(actual);
+    std::string expectedLine;
+    std::string actualLine;
+    for (unsigned int line = 1; ; line++)
+    {
+        bool hasExpected = (bool)std::getline(expectedStream, expectedLine);
+        bool hasActual = (bool)std::getline(actualStream, actualLine);
+        if (!hasExpected && !hasActual)
+        {
+            // Only the final newline differs
+            std::cout << "    output differs at the end\n";
+            return;
+        }
+        if (hasExpected != hasActual || expectedLine != actualLine)
+        {
+            std::cout << "    line " << line << '\n';
+            std::cout << "    " << std::setw(12) << referenceName << ": " << (hasExpected ? expectedLine : "<end of output>") << '\n';
+            std::cout << "    " << std::setw(12) << tierName << ": " << (hasActual ? actualLine : "<end of output>") << '\n';
+            return;
+        }
+    }
+}
+
+static double Median(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    size_t middle = values.size() / 2;
+    return values.size() % 2 == 1 ? values[middle] : (values[middle - 1] + values[middle]) / 2.0;
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string> paths;
+    std::string cacheDirectory = "";
+    unsigned int runs = 3;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "-runs" && i + 1 < argc)
+        {
+            try
+            {
+                runs = std::max(1ul, std::stoul(argv[++i]));
+            }
+            catch (const std::exception& e)
+            {
+                std::cout << "Invalid run count " << argv[i] << '\n';
+                return 1;
+            }
+        }
+        else if (arg == "-cachedir" && i + 1 < argc)
+        {
+            cacheDirectory = argv[++i];
+        }
+        else if (arg[0] != '-')
+        {
+            FindScripts(arg, paths);
+        }
+        else
+        {
+            std::cout << "Usage: DiffTest <paths...> [-runs N] [-cachedir directory]\n";
+            return 1;
+        }
+    }
+
+    if (paths.empty())
+    {
+        std::cout << "No scripts given.\n";
+        return 1;
+    }
+
+    // Entries written by the tiers aren't meant to end up beside the scripts
+    if (cacheDirectory.empty())
+    {
+        cacheDirectory = (std::filesystem::temp_directory_path() / "planetoid_difftest_cache").string();
+    }
+
+    Interpreter interpreter;
+    interpreter.GetModuleCache().SetDirectory(cacheDirectory);
+
+    const size_t tierCount = sizeof(s_tiers) / sizeof(s_tiers[0]);
+    const Tier& reference = s_tiers[0];
+    std::vector<double> logRatioTotals(tierCount, 0.0);
+    unsigned int failed = 0;
+    unsigned int timedCount = 0;
+
+    std::cout << std::fixed;
+    std::cout << std::left << std::setw(28) << "script" << std::right << std::setw(12) << reference.name;
+    for (size_t tier = 1; tier < tierCount; tier++)
+    {
+        std::cout << std::setw(12) << s_tiers[tier].name;
+    }
+    std::cout << '\n';
+
+    for (const std::string& path : paths)
+    {
+        // With its directory, since the same name can be in more than one
+        std::filesystem::path scriptPath(path);
+        std::string name = (scriptPath.parent_path().filename() / scriptPath.filename()).generic_string();
+        const SourceFile* source = SourceFile::Load(path);
+        if (source == nullptr)
+        {
+            std::cout << std::left << std::setw(28) << name << std::right << " failed to open\n";
+            failed++;
+            continue;
+        }
+        std::string tree = WriteTree(source);
+
+        // The first run of each tier isn't timed. It also fills the module cache for the tiers that read it.
+        std::string expected = "";
+        std::vector<double> medians;
+        std::vector<std::string> mismatches;
+        for (size_t tier = 0; tier < tierCount; tier++)
+        {
+            std::vector<double> seconds;
+            bool isMatch = true;
+            for (unsigned int run = 0; run <= runs; run++)
+            {
+                Run result = RunScript(interpreter, source, s_tiers[tier], tree);
+                if (tier == 0 && run == 0)
+                {
+                    expected = result.output;
+                }
+                else if (isMatch && result.output != expected)
+                {
+                    isMatch = false;
+                    std::cout << name << ": " << s_tiers[tier].name << " run " << run + 1 << " differs from " << reference.name << " run 1\n";
+                    PrintDifference(expected, result.output, reference.name, s_tiers[tier].name);
+                }
+                if (run != 0)
+                {
+                    seconds.push_back(result.seconds);
+                }
+            }
+            medians.push_back(Median(seconds));
+            if (!isMatch)
+            {
+                mismatches.push_back(s_tiers[tier].name);
+            }
+        }
+
+        std::cout << std::left << std::setw(28) << name << std::right << std::setw(10) << std::setprecision(3) << medians[0] * 1000.0 << "ms";
+        for (size_t tier = 1; tier < tierCount; tier++)
+        {
+            double ratio = medians[0] > 0.0 ? medians[tier] / medians[0] : 1.0;
+            logRatioTotals[tier] += std::log(ratio);
+            std::cout << std::setw(11) << std::setprecision(2) << ratio << 'x';
+        }
+        for (const std::string& mismatch : mismatches)
+        {
+            std::cout << "  " << mismatch << " DIFFERS";
+        }
+        std::cout << '\n';
+
+        timedCount++;
+        failed += !mismatches.empty();
+    }
+
+    if (timedCount != 0)
+    {
+        std::cout << std::left << std::setw(28) << "geometric mean" << std::right << std::setw(12) << "";
+        for (size_t tier = 1; tier < tierCount; tier++)
+        {
+            std::cout << std::setw(11) << std::setprecision(2) << std::exp(logRatioTotals[tier] / timedCount) << 'x';
+        }
+        std::cout << '\n';
+    }
+
+    std::cout << paths.size() << " scripts under " << tierCount << " tiers, " << failed << " failed\n";
+    return failed == 0 ? 0 : 1;
+}
\ No newline at end of file
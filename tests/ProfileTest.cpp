@@ -0,0 +1,100 @@
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+
+#include "Interpreter.hpp"
+#include "Lexer.hpp"
+#include "Parser.hpp"
+#include "Profiler.hpp"
+#include "SourceFile.hpp"
+
+// Profiles a script whose time is spent on known lines and checks the samples land on those lines,
+// rather than on the statement that runs after them.
+
+// Line 6 is a hot loop, the last statement of the function it's in. Lines 10 and 12 are slow on their own,
+// and 12 is the script's last statement. Lines 9 and 11 take next to no time themselves.
+static const char* s_script =
+    "spin = func\n"
+    "{\n"
+    "    total = 0;\n"
+    "    for (i = 0; i < args[0]; i = i + 1)\n"
+    "    {\n"
+    "        total = total + i;\n"
+    "    };\n"
+    "};\n"
+    "spin(100000);\n"
+    "filled = randomarray(1000000, 0, 1);\n"
+    "after = 1;\n"
+    "filled = randomarray(1000000, 0, 1);\n";
+
+// Samples by their collapsed stack and line, as Profiler::Write puts them
+static std::map<std::string, unsigned long long> ReadSamples(const std::string& path)
+{
+    std::map<std::string, unsigned long long> samples;
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line))
+    {
+        size_t separator = line.rfind(' ');
+        if (separator != std::string::npos)
+        {
+            samples[line.substr(0, separator)] = std::stoull(line.substr(separator + 1));
+        }
+    }
+    return samples;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc != 2)
+    {
+        std::cout << "Usage: ProfileTest <output file>\n";
+        return 1;
+    }
+
+    const SourceFile* source = SourceFile::Keep(SourceFile::FromString("profile.txt", s_script));
+    Lexer lexer(source);
+    Parser parser(lexer);
+    TokenNode* node = parser.Parse();
+    if (node == NULL)
+    {
+        std::cout << "The script didn't parse.\n";
+        return 1;
+    }
+
+    Interpreter interpreter;
+    Profiler profiler;
+    interpreter.SetProfiler(&profiler);
+    profiler.Start(200);
+    interpreter.Interpret(node);
+    interpreter.Reset();
+    profiler.Stop();
+    interpreter.SetProfiler(nullptr);
+
+    if (!profiler.Write(argv[1]))
+    {
+        std::cout << "Failed to write " << argv[1] << '\n';
+        return 1;
+    }
+    std::map<std::string, unsigned long long> samples = ReadSamples(argv[1]);
+    for (const auto& sample : samples)
+    {
+        std::cout << sample.first << ' ' << sample.second << '\n';
+    }
+
+    unsigned int failed = 0;
+    auto expectMore = [&samples, &failed](const std::string& hot, const std::string& cold)
+    {
+        if (samples[hot] <= samples[cold])
+        {
+            std::cout << "FAILED: " << hot << " should have more samples than " << cold << '\n';
+            failed++;
+        }
+    };
+    expectMore("main;spin;profile.txt:6", "main;profile.txt:9");
+    expectMore("main;profile.txt:10", "main;profile.txt:11");
+    expectMore("main;profile.txt:12", "main;profile.txt:11");
+    return failed == 0 ? 0 : 1;
+}
\ No newline at end of file